@@ -154,6 +154,26 @@ static void HASH_X11_0080b_single(benchmark::State& state)
         hash = HashX11(in.begin(), in.end());
 }
 
+static void HASH_X11_0080b_batch(benchmark::State& state)
+{
+    uint256 hashes[X11_BATCH_LANES];
+    std::vector<uint8_t> in(80 * X11_BATCH_LANES,0);
+    while (state.KeepRunning())
+        HashX11Headers(in.data(), X11_BATCH_LANES, hashes);
+}
+
+static void HASH_X11_0080b_nonces(benchmark::State& state)
+{
+    uint256 hashes[X11_BATCH_LANES];
+    std::vector<uint8_t> in(80,0);
+    CX11NonceHasher hasher(in.data());
+    uint32_t nNonce = 0;
+    while (state.KeepRunning()) {
+        hasher.Hash(nNonce, X11_BATCH_LANES, hashes);
+        nNonce += X11_BATCH_LANES;
+    }
+}
+
 static void HASH_X11_0128b_single(benchmark::State& state)
 {
     uint256 hash;
@@ -205,6 +225,8 @@ BENCHMARK(HASH_DSHA256_1024b_single);
 BENCHMARK(HASH_DSHA256_2048b_single);
 BENCHMARK(HASH_X11_0032b_single);
 BENCHMARK(HASH_X11_0080b_single);
+BENCHMARK(HASH_X11_0080b_batch);
+BENCHMARK(HASH_X11_0080b_nonces);
 BENCHMARK(HASH_X11_0128b_single);
 BENCHMARK(HASH_X11_0512b_single);
 BENCHMARK(HASH_X11_1024b_single);
@@ -0,0 +1,108 @@
+// Copyright (c) 2017-2022 The Advanced Technology Coin
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "goldminenode_setup.h"
+
+#include "flat-database.h"
+#include "util.h"
+
+#include <boost/filesystem.hpp>
+
+// Every call scores the whole list for a block not in the rank cache
+static void GoldminenodeRanksCold(benchmark::State& state)
+{
+    CGoldminenodeBenchSetup setup;
+    CGoldminenodeMan::rank_pair_vec_t vecRanks;
+    int nOffset = 0;
+    while (state.KeepRunning()) {
+        // cycle through far more blocks than MAX_RANK_CACHE_SIZE
+        int nBlockHeight = 101 + nOffset++ % (setup.Height() - 101);
+        mnodeman.GetGoldminenodeRanks(vecRanks, nBlockHeight);
+    }
+}
+
+// Repeated lookups for the same block, as done while validating a burst of votes
+static void GoldminenodeRankCached(benchmark::State& state)
+{
+    CGoldminenodeBenchSetup setup;
+    int nRank;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        mnodeman.GetGoldminenodeRank(setup.vOutpoints[i++ % setup.vOutpoints.size()], nRank, setup.Height() - 101);
+    }
+}
+
+static void GoldminenodeNextInQueue(benchmark::State& state)
+{
+    CGoldminenodeBenchSetup setup;
+    int nCount;
+    goldminenode_info_t mnInfo;
+    while (state.KeepRunning()) {
+        mnodeman.GetNextGoldminenodeInQueueForPayment(setup.Height() + 1, false, nCount, mnInfo);
+    }
+}
+
+// Signature check of a single payment vote. The message signature cache is
+// not initialized here, so every round pays for the public key recovery.
+static void GoldminenodePaymentVoteVerify(benchmark::State& state)
+{
+    CGoldminenodeBenchSetup setup(100);
+    std::vector<CGoldminenodePaymentVote> vVotes = setup.CreatePaymentVotes(setup.Height() + 1);
+    int nDos;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const size_t n = i++ % vVotes.size();
+        vVotes[n].CheckSignature(setup.vKeys[n].GetPubKey(), setup.Height(), nDos);
+    }
+}
+
+// Bookkeeping done for every vote once its signature was verified,
+// the map of votes is reset whenever all goldminenodes have voted
+static void GoldminenodePaymentVoteProcess(benchmark::State& state)
+{
+    CGoldminenodeBenchSetup setup;
+    std::vector<CGoldminenodePaymentVote> vVotes = setup.CreatePaymentVotes(setup.Height() + 1);
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const size_t n = i++ % vVotes.size();
+        if (n == 0) mnpayments.Clear();
+        mnpayments.ProcessVerifiedPaymentVote(NULL, vVotes[n], true, 0, setup.connman);
+    }
+}
+
+static void GoldminenodeCacheDumpLoad(benchmark::State& state)
+{
+    CGoldminenodeBenchSetup setup;
+
+    boost::filesystem::path pathTemp = boost::filesystem::temp_directory_path() / strprintf("bench_arc_%lu_%i", (unsigned long)GetTime(), (int)GetRand(100000));
+    boost::filesystem::create_directories(pathTemp);
+    // arguments cannot be unset, the default directory is what GetDataDir() used without one
+    const std::string strDataDirOld = IsArgSet("-datadir") ? GetArg("-datadir", "") : GetDefaultDataDir().string();
+    ForceSetArg("-datadir", pathTemp.string());
+    ClearDatadirCache();
+
+    {
+        CFlatDB<CGoldminenodeMan> flatdb("mncache.dat", "magicGoldminenodeCache");
+        while (state.KeepRunning()) {
+            // a changed list has to be written out in full
+            boost::filesystem::remove(GetDataDir() / "mncache.dat");
+            flatdb.Dump(mnodeman);
+            CGoldminenodeMan mnodemanLoaded;
+            flatdb.Load(mnodemanLoaded);
+        }
+    }
+
+    ForceSetArg("-datadir", strDataDirOld);
+    ClearDatadirCache();
+    boost::filesystem::remove_all(pathTemp);
+}
+
+BENCHMARK(GoldminenodeRanksCold);
+BENCHMARK(GoldminenodeRankCached);
+BENCHMARK(GoldminenodeNextInQueue);
+BENCHMARK(GoldminenodePaymentVoteVerify);
+BENCHMARK(GoldminenodePaymentVoteProcess);
+BENCHMARK(GoldminenodeCacheDumpLoad);
@@ -0,0 +1,114 @@
+// Copyright (c) 2017-2022 The Advanced Technology Coin
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_BENCH_GOLDMINENODE_SETUP_H
+#define BITCOIN_BENCH_GOLDMINENODE_SETUP_H
+
+#include "activegoldminenode.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "coins.h"
+#include "goldminenode-payments.h"
+#include "goldminenode-sync.h"
+#include "goldminenodeman.h"
+#include "key.h"
+#include "net.h"
+#include "netbase.h"
+#include "pubkey.h"
+#include "random.h"
+#include "tinyformat.h"
+#include "validation.h"
+
+static const int BENCH_GOLDMINENODES = 1000;
+// must be higher than the node count, collaterals need that many confirmations to be paid
+static const int BENCH_CHAIN_HEIGHT = 2000;
+
+/**
+ * Synthetic goldminenode network: a fake active chain, a coins view holding
+ * the collaterals and a fully synced goldminenode list. Everything lives in
+ * the usual globals, so only one instance may exist at a time.
+ */
+class CGoldminenodeBenchSetup
+{
+public:
+    // every signature check recovers a public key
+    const ECCVerifyHandle verifyHandle;
+    CConnman connman;
+    CCoinsView viewDummy;
+    std::vector<uint256> vHashes;
+    std::vector<CBlockIndex> vBlocks;
+    std::vector<CKey> vKeys;
+    std::vector<COutPoint> vOutpoints;
+
+    CGoldminenodeBenchSetup(int nNodes = BENCH_GOLDMINENODES, int nHeight = BENCH_CHAIN_HEIGHT) : connman(0x1337, 0x1337)
+    {
+        vHashes.resize(nHeight + 1);
+        vBlocks.resize(nHeight + 1);
+        for (int i = 0; i <= nHeight; i++) {
+            vHashes[i] = GetRandHash();
+            vBlocks[i].phashBlock = &vHashes[i];
+            vBlocks[i].nHeight = i;
+            vBlocks[i].pprev = i ? &vBlocks[i - 1] : NULL;
+            vBlocks[i].BuildSkip();
+        }
+
+        LOCK(cs_main);
+        SetActiveChainTip(&vBlocks.back());
+        pcoinsTip = new CCoinsViewCache(&viewDummy);
+
+        for (int i = 0; i < nNodes; i++) {
+            CKey keyCollateral, keyGoldminenode;
+            keyCollateral.MakeNewKey(true);
+            keyGoldminenode.MakeNewKey(true);
+
+            COutPoint outpoint(GetRandHash(), 0);
+            CTxOut txout(10000 * COIN, GetScriptForDestination(keyCollateral.GetPubKey().GetID()));
+            pcoinsTip->AddCoin(outpoint, Coin(txout, 1, false), false);
+
+            CService addr = LookupNumeric(strprintf("10.%d.%d.%d", (i >> 16) & 0xff, (i >> 8) & 0xff, i & 0xff).c_str(), Params().GetDefaultPort());
+            CGoldminenode mn(addr, outpoint, keyCollateral.GetPubKey(), keyGoldminenode.GetPubKey(), PROTOCOL_VERSION);
+            mnodeman.Add(mn);
+
+            vKeys.push_back(keyGoldminenode);
+            vOutpoints.push_back(outpoint);
+        }
+
+        while (!goldminenodeSync.IsSynced()) {
+            goldminenodeSync.SwitchToNextAsset(connman);
+        }
+    }
+
+    ~CGoldminenodeBenchSetup()
+    {
+        goldminenodeSync.Reset();
+        mnpayments.Clear();
+        mnodeman.Clear();
+
+        LOCK(cs_main);
+        SetActiveChainTip(NULL);
+        delete pcoinsTip;
+        pcoinsTip = NULL;
+    }
+
+    int Height() const { return (int)vBlocks.size() - 1; }
+
+    /** Payment votes for nBlockHeight, one per goldminenode, signed with its own key */
+    std::vector<CGoldminenodePaymentVote> CreatePaymentVotes(int nBlockHeight)
+    {
+        std::vector<CGoldminenodePaymentVote> vVotes;
+        for (size_t i = 0; i < vOutpoints.size(); i++) {
+            CScript payee = GetScriptForDestination(vKeys[(i + 1) % vKeys.size()].GetPubKey().GetID());
+            CGoldminenodePaymentVote vote(vOutpoints[i], nBlockHeight, payee);
+            activeGoldminenode.keyGoldminenode = vKeys[i];
+            activeGoldminenode.pubKeyGoldminenode = vKeys[i].GetPubKey();
+            vote.Sign();
+            vVotes.push_back(vote);
+        }
+        activeGoldminenode.keyGoldminenode = CKey();
+        activeGoldminenode.pubKeyGoldminenode = CPubKey();
+        return vVotes;
+    }
+};
+
+#endif // BITCOIN_BENCH_GOLDMINENODE_SETUP_H
@@ -0,0 +1,96 @@
+// Copyright (c) 2017-2022 The Advanced Technology Coin
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "goldminenode_setup.h"
+
+#include "instantx.h"
+#include "protocol.h"
+#include "streams.h"
+#include "utiltime.h"
+
+#include <memory>
+
+static const int BENCH_LOCK_VOTERS = 10;
+// the lock inputs only need enough confirmations for their goldminenode ranks
+static const int BENCH_LOCK_CHAIN_HEIGHT = 100;
+//! Rounds of orphan votes kept before the InstantSend state is dropped again
+static const int BENCH_LOCK_ROUNDS = 1000;
+
+/** Lock votes from every goldminenode of the setup for a single input of txHash */
+static std::vector<CTxLockVote> CreateTxLockVotes(CGoldminenodeBenchSetup& setup, const uint256& txHash, const COutPoint& outpoint)
+{
+    std::vector<CTxLockVote> vVotes;
+    for (size_t i = 0; i < setup.vOutpoints.size(); i++) {
+        CTxLockVote vote(txHash, outpoint, setup.vOutpoints[i]);
+        activeGoldminenode.keyGoldminenode = setup.vKeys[i];
+        activeGoldminenode.pubKeyGoldminenode = setup.vKeys[i].GetPubKey();
+        vote.Sign();
+        vVotes.push_back(vote);
+    }
+    activeGoldminenode.keyGoldminenode = CKey();
+    activeGoldminenode.pubKeyGoldminenode = CPubKey();
+    return vVotes;
+}
+
+static void TxLockVoteVerify(benchmark::State& state)
+{
+    CGoldminenodeBenchSetup setup(BENCH_LOCK_VOTERS, BENCH_LOCK_CHAIN_HEIGHT);
+    std::vector<CTxLockVote> vVotes = CreateTxLockVotes(setup, GetRandHash(), COutPoint(GetRandHash(), 0));
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        vVotes[i++ % vVotes.size()].CheckSignature();
+    }
+}
+
+// Votes arriving from a peer before the lock request itself, the common case
+// when a lock is relayed through the network. Every round of votes is for a
+// new transaction spending the same input. Each vote goes through the full
+// message handling, so the signature check measured by TxLockVoteVerify is
+// part of it. A fresh CInstantSend replaces the old one every
+// BENCH_LOCK_ROUNDS rounds so the state stays bounded.
+static void TxLockVoteProcessOrphan(benchmark::State& state)
+{
+    // keep every orphan vote expiration the same, later ones would be taken for spam
+    SetMockTime(GetTime());
+
+    CGoldminenodeBenchSetup setup(BENCH_LOCK_VOTERS, BENCH_LOCK_CHAIN_HEIGHT);
+    COutPoint outpoint(GetRandHash(), 0);
+    {
+        LOCK(cs_main);
+        CKey key;
+        key.MakeNewKey(true);
+        CTxOut txout(COIN, GetScriptForDestination(key.GetPubKey().GetID()));
+        pcoinsTip->AddCoin(outpoint, Coin(txout, 1, false), false);
+    }
+
+    std::vector<CDataStream> vMessages;
+    for (int i = 0; i < BENCH_LOCK_ROUNDS; i++) {
+        for (const auto& vote : CreateTxLockVotes(setup, GetRandHash(), outpoint)) {
+            vMessages.emplace_back(SER_NETWORK, PROTOCOL_VERSION);
+            vMessages.back() << vote;
+        }
+    }
+
+    CAddress addr(CService(LookupNumeric("10.255.0.1", Params().GetDefaultPort())), NODE_NONE);
+    CNode node(0, NODE_NETWORK, 0, INVALID_SOCKET, addr, 0, 0, "", true);
+    node.nVersion = PROTOCOL_VERSION;
+
+    std::unique_ptr<CInstantSend> pinstantsend;
+    size_t i = 0;
+    while (state.KeepRunning()) {
+        const size_t n = i++ % vMessages.size();
+        if (n == 0)
+            pinstantsend.reset(new CInstantSend());
+        CDataStream vRecv(vMessages[n]);
+        pinstantsend->ProcessMessage(&node, NetMsgType::TXLOCKVOTE, vRecv, setup.connman);
+    }
+
+    pinstantsend.reset();
+    SetMockTime(0);
+}
+
+BENCHMARK(TxLockVoteVerify);
+BENCHMARK(TxLockVoteProcessOrphan);
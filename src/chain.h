@@ -12,6 +12,8 @@
 #include "tinyformat.h"
 #include "uint256.h"
 
+#include <atomic>
+#include <string.h>
 #include <vector>
 
 class CBlockFileInfo
@@ -419,6 +421,59 @@ public:
     }
 };
 
+/**
+ * Chunked storage for CBlockIndex entries. Block index entries are only ever
+ * released all together (UnloadBlockIndex, shutdown), so instead of one heap
+ * allocation per header they are placed next to each other in large chunks.
+ * This saves the allocator overhead per entry and keeps headers that were
+ * added one after another (as during sync) close together in memory.
+ * Not thread safe, callers hold cs_main.
+ */
+class CBlockIndexArena
+{
+private:
+    static const size_t CHUNK_ENTRIES = 4096;
+    std::vector<std::vector<CBlockIndex> > vChunks;
+    size_t nSize;
+
+    std::vector<CBlockIndex>& GetChunk()
+    {
+        if (vChunks.empty() || vChunks.back().size() == CHUNK_ENTRIES) {
+            vChunks.push_back(std::vector<CBlockIndex>());
+            // never grown past this, so pointers into the chunk stay valid
+            vChunks.back().reserve(CHUNK_ENTRIES);
+        }
+        nSize++;
+        return vChunks.back();
+    }
+
+public:
+    CBlockIndexArena() : nSize(0) {}
+
+    CBlockIndex* Allocate()
+    {
+        std::vector<CBlockIndex>& chunk = GetChunk();
+        chunk.push_back(CBlockIndex());
+        return &chunk.back();
+    }
+
+    CBlockIndex* Allocate(const CBlockHeader& block)
+    {
+        std::vector<CBlockIndex>& chunk = GetChunk();
+        chunk.push_back(CBlockIndex(block));
+        return &chunk.back();
+    }
+
+    /** Release all entries, any pointer handed out before is invalid afterwards */
+    void Clear()
+    {
+        vChunks.clear();
+        nSize = 0;
+    }
+
+    size_t Size() const { return nSize; }
+};
+
 /** An in-memory indexed chain of blocks. */
 class CChain {
 private:
@@ -479,4 +534,110 @@ public:
     CBlockIndex* FindEarliestAtLeast(int64_t nTime) const;
 };
 
+/**
+ * Hashes of the most recent blocks of the active chain by height, readable without cs_main.
+ * Goldminenode, payment and InstantSend code map heights to hashes for every message; with
+ * this they don't have to wait for cs_main while a block is being connected.
+ * Written under cs_main whenever the tip changes, each slot is guarded by a sequence
+ * counter that is odd while the slot is being rewritten.
+ */
+class CActiveChainHashes
+{
+public:
+    //! Number of heights below and including the tip that can be looked up
+    static const int SLOTS = 8192;
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> nSeq;
+        std::atomic<int> nHeight;
+        std::atomic<uint64_t> hash[4];
+    };
+
+    Slot slots[SLOTS];
+    std::atomic<int> nTipHeight;
+
+    void Publish(Slot& slot, int nHeight, const uint64_t words[4])
+    {
+        uint32_t nSeq = slot.nSeq.load(std::memory_order_relaxed);
+        slot.nSeq.store(nSeq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.nHeight.store(nHeight, std::memory_order_relaxed);
+        for (int j = 0; j < 4; j++)
+            slot.hash[j].store(words[j], std::memory_order_relaxed);
+        slot.nSeq.store(nSeq + 2, std::memory_order_release);
+    }
+
+public:
+    CActiveChainHashes() : nTipHeight(-1)
+    {
+        for (int i = 0; i < SLOTS; i++) {
+            slots[i].nSeq = 0;
+            slots[i].nHeight = -1;
+            for (int j = 0; j < 4; j++)
+                slots[i].hash[j] = 0;
+        }
+    }
+
+    /** Publish the chain ending in pindexTip, requires cs_main */
+    void SetTip(const CBlockIndex* pindexTip)
+    {
+        int nHeight = pindexTip ? pindexTip->nHeight : -1;
+        int nHeightOld = nTipHeight.load(std::memory_order_relaxed);
+
+        // Heights above the new tip are gone. Their slots must not look current when
+        // a chain through the same blocks comes back, or the walk below would stop early.
+        static const uint64_t wordsNull[4] = {0, 0, 0, 0};
+        for (int i = std::max(nHeight + 1, nHeightOld - SLOTS + 1); i <= nHeightOld; i++) {
+            Slot& slot = slots[i % SLOTS];
+            if (slot.nHeight.load(std::memory_order_relaxed) == i)
+                Publish(slot, -1, wordsNull);
+        }
+
+        // walk back until the slots agree with the new chain, usually just the new tip
+        for (const CBlockIndex* pindex = pindexTip; pindex && pindex->nHeight > nHeight - SLOTS; pindex = pindex->pprev) {
+            Slot& slot = slots[pindex->nHeight % SLOTS];
+            const uint256& hash = pindex->GetBlockHash();
+            uint64_t words[4];
+            memcpy(words, hash.begin(), 32);
+            if (slot.nHeight.load(std::memory_order_relaxed) == pindex->nHeight &&
+                slot.hash[0].load(std::memory_order_relaxed) == words[0] && slot.hash[1].load(std::memory_order_relaxed) == words[1] &&
+                slot.hash[2].load(std::memory_order_relaxed) == words[2] && slot.hash[3].load(std::memory_order_relaxed) == words[3])
+                break;
+            Publish(slot, pindex->nHeight, words);
+        }
+        nTipHeight.store(nHeight, std::memory_order_release);
+    }
+
+    int Height() const
+    {
+        return nTipHeight.load(std::memory_order_acquire);
+    }
+
+    /** Hash of the active chain block at nHeight, false if it isn't (or no longer) in the window */
+    bool Get(int nHeight, uint256& hashRet) const
+    {
+        if (nHeight < 0 || nHeight > Height())
+            return false;
+        const Slot& slot = slots[nHeight % SLOTS];
+        while (true) {
+            uint32_t nSeq = slot.nSeq.load(std::memory_order_acquire);
+            if (nSeq & 1)
+                continue;
+            int nSlotHeight = slot.nHeight.load(std::memory_order_relaxed);
+            uint64_t words[4];
+            for (int j = 0; j < 4; j++)
+                words[j] = slot.hash[j].load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.nSeq.load(std::memory_order_relaxed) != nSeq)
+                continue;
+            if (nSlotHeight != nHeight)
+                return false;
+            memcpy(hashRet.begin(), words, 32);
+            return true;
+        }
+    }
+};
+
+
 #endif // BITCOIN_CHAIN_H
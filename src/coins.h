@@ -223,6 +223,13 @@ public:
      */
     bool HaveCoinInCache(const COutPoint &outpoint) const;
 
+    /**
+     * Store a coin that was read from the backing view by someone else (e.g. a prefetch
+     * thread), as an unmodified entry just like a cache miss would. Does nothing if the
+     * outpoint is cached already. The coin must reflect the current state of the base.
+     */
+    void AddFetchedCoin(const COutPoint &outpoint, Coin&& coin);
+
     /**
      * Return a reference to Coin in the cache, or a pruned one if not found. This is
      * more efficient than GetCoin.
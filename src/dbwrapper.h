@@ -26,8 +26,27 @@ public:
     dbwrapper_error(const std::string& msg) : std::runtime_error(msg) {}
 };
 
+static const int DEFAULT_DB_MAX_OPEN_FILES = 64;
+static const int DEFAULT_DB_BLOOM_BITS = 10;
+
 class CDBWrapper;
 
+/** LevelDB tuning of a single database */
+struct CDBOptions
+{
+    //! Memory budget: half of it for the block cache, up to two write buffers of a quarter each
+    size_t nCacheSize;
+    int nMaxOpenFiles;
+    //! Bloom filter bits per key, 0 disables the filter
+    int nBloomBits;
+
+    explicit CDBOptions(size_t nCacheSizeIn = 0) :
+        nCacheSize(nCacheSizeIn), nMaxOpenFiles(DEFAULT_DB_MAX_OPEN_FILES), nBloomBits(DEFAULT_DB_BLOOM_BITS) {}
+
+    /** Defaults for a database named strName, overridden by -<strName>dbmaxopenfiles and -<strName>dbbloombits */
+    static CDBOptions FromArgs(const std::string& strName, size_t nCacheSize);
+};
+
 /** These should be considered an implementation detail of the specific database.
  */
 namespace dbwrapper_private {
@@ -131,6 +150,7 @@ public:
     bool Valid();
 
     void SeekToFirst();
+    void SeekToLast();
 
     template<typename K> void Seek(const K& key) {
         CDataStream ssKey(SER_DISK, CLIENT_VERSION);
@@ -141,6 +161,7 @@ public:
     }
 
     void Next();
+    void Prev();
 
     template<typename K> bool GetKey(K& key) {
         leveldb::Slice slKey = piter->key();
@@ -173,6 +194,24 @@ public:
         return piter->value().size();
     }
 
+    /** Append the raw (still obfuscated) value to vch, for decoding elsewhere with DecodeValue() */
+    void GetValueRaw(std::vector<char>& vch) {
+        leveldb::Slice slValue = piter->value();
+        vch.insert(vch.end(), slValue.data(), slValue.data() + slValue.size());
+    }
+
+    /** Decode a value appended by GetValueRaw(); safe to call from other threads */
+    template<typename V> bool DecodeValue(const char* pbegin, const char* pend, V& value) const {
+        try {
+            CDataStream ssValue(pbegin, pend, SER_DISK, CLIENT_VERSION);
+            ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
+            ssValue >> value;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
 };
 
 class CDBWrapper
@@ -221,6 +260,8 @@ public:
      *                        with a zero'd byte array.
      */
     CDBWrapper(const boost::filesystem::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    /** Same as above with every leveldb setting taken from dbOptions */
+    CDBWrapper(const boost::filesystem::path& path, const CDBOptions& dbOptions, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
     ~CDBWrapper();
 
     template <typename K, typename V>
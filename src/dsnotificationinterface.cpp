@@ -31,6 +31,10 @@ void CDSNotificationInterface::NotifyHeaderTip(const CBlockIndex *pindexNew, boo
 
 void CDSNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
 {
+    // blocks above the fork point were disconnected, even when no new ones were connected
+    if (pindexFork && pindexFork != pindexNew->pprev)
+        mnodeman.DisconnectedBlocks(pindexFork);
+
     if (pindexNew == pindexFork) // blocks were disconnected without any new ones
         return;
 
@@ -56,6 +60,7 @@ void CDSNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, con
 
 void CDSNotificationInterface::SyncTransaction(const CTransaction &tx, const CBlockIndex *pindex, int posInBlock)
 {
+    mnodeman.SyncTransaction(tx, pindex, posInBlock);
     instantsend.SyncTransaction(tx, pindex, posInBlock);
     CPrivateSend::SyncTransaction(tx, pindex, posInBlock);
 }
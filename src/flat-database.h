@@ -7,15 +7,27 @@
 
 #include "chainparams.h"
 #include "clientversion.h"
+#include "dbwrapper.h"
 #include "hash.h"
+#include "random.h"
 #include "streams.h"
 #include "util.h"
 
+#include <map>
+#include <memory>
+#include <set>
+
 #include <boost/filesystem.hpp>
 
 /** 
 *   Generic Dumping and Loading
 *   ---------------------------
+*
+*   The whole object is stored as one snapshot. A dump serializes and hashes
+*   everything, but leaves the file alone when the hash matches the stored one,
+*   and replaces it through a temporary file otherwise. Loading reads the whole
+*   file at startup. Maps too large to rewrite on every dump are left out of the
+*   snapshot and kept in a CFlatDBMap instead.
 */
 
 template<typename T>
@@ -37,7 +49,7 @@ private:
     std::string strFilename;
     std::string strMagicMessage;
 
-    bool Write(const T& objToSave)
+    bool Write(const T& objToSave, const uint256& hashOnDisk)
     {
         // LOCK(objToSave.cs);
 
@@ -49,13 +61,26 @@ private:
         ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
         ssObj << objToSave;
         uint256 hash = Hash(ssObj.begin(), ssObj.end());
+
+        // nothing changed since the file was written, no need to touch it
+        if (hash == hashOnDisk) {
+            LogPrintf("%s is up to date  %dms\n", strFilename, GetTimeMillis() - nStart);
+            return true;
+        }
+
         ssObj << hash;
 
-        // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        // write to a temporary file first so that an interrupted dump
+        // can't leave a truncated file behind
+        unsigned short randv = 0;
+        GetRandBytes((unsigned char*)&randv, sizeof(randv));
+        boost::filesystem::path pathTmp = GetDataDir() / strprintf("%s.%04x", strFilename, randv);
+
+        // open temp output file, and associate with CAutoFile
+        FILE *file = fopen(pathTmp.string().c_str(), "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
         // Write and commit header, data
         try {
@@ -64,14 +89,74 @@ private:
         catch (std::exception &e) {
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        FileCommit(fileout.Get());
         fileout.fclose();
 
+        // replace existing file, if any, with the new one
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s: Rename-into-place failed", __func__);
+
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
 
         return true;
     }
 
+    /**
+     * Check only the magic message and network magic of the existing file,
+     * Dump uses this instead of a full Read so that it doesn't have to
+     * deserialize the old data just to find out whether it may overwrite it.
+     * The stored checksum is returned in hashRet (null if unavailable).
+     */
+    ReadResult ReadHeader(uint256& hashRet)
+    {
+        hashRet.SetNull();
+
+        // open input file, and associate with CAutoFile
+        FILE *file = fopen(pathDB.string().c_str(), "rb");
+        CAutoFile filein(file, SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull())
+        {
+            error("%s: Failed to open file %s", __func__, pathDB.string());
+            return FileError;
+        }
+
+        unsigned char pchMsgTmp[4];
+        std::string strMagicMessageTmp;
+        try {
+            // de-serialize file header (file specific magic message) and ..
+            filein >> strMagicMessageTmp;
+
+            // ... verify the message matches predefined one
+            if (strMagicMessage != strMagicMessageTmp)
+            {
+                error("%s: Invalid magic message", __func__);
+                return IncorrectMagicMessage;
+            }
+
+            // de-serialize file header (network specific magic number) and ..
+            filein >> FLATDATA(pchMsgTmp);
+
+            // ... verify the network matches ours
+            if (memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp)))
+            {
+                error("%s: Invalid network magic number", __func__);
+                return IncorrectMagicNumber;
+            }
+
+            // checksum is stored in the last bytes of the file
+            if (fseek(filein.Get(), -(long)sizeof(uint256), SEEK_END) == 0)
+                filein >> hashRet;
+        }
+        catch (std::exception &e) {
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            return IncorrectFormat;
+        }
+        filein.fclose();
+
+        return Ok;
+    }
+
     ReadResult Read(T& objToLoad, bool fDryRun = false)
     {
         //LOCK(objToLoad.cs);
@@ -198,8 +283,8 @@ public:
         int64_t nStart = GetTimeMillis();
 
         LogPrintf("Verifying %s format...\n", strFilename);
-        T tmpObjToLoad;
-        ReadResult readResult = Read(tmpObjToLoad, true);
+        uint256 hashOnDisk;
+        ReadResult readResult = ReadHeader(hashOnDisk);
 
         // there was an error and it was not an error on file opening => do not proceed
         if (readResult == FileError)
@@ -217,7 +302,7 @@ public:
         }
 
         LogPrintf("Writing info to %s...\n", strFilename);
-        Write(objToSave);
+        Write(objToSave, hashOnDisk);
         LogPrintf("%s dump finished  %dms\n", strFilename, GetTimeMillis() - nStart);
 
         return true;
@@ -225,5 +310,105 @@ public:
 
 };
 
+/**
+*   Maps Written By Change
+*   ----------------------
+*
+*   A map kept in a LevelDB database of its own, with one record per entry.
+*   The owner calls SetDirty for every key it inserts, changes or erases, under
+*   the lock that protects the map, and Write only touches those records. Until
+*   the map was loaded from the database, or after SetAllDirty, the next Write
+*   replaces the whole database.
+*/
+template<typename K, typename V>
+class CFlatDBMap
+{
+private:
+    static const size_t nCacheSize = 1 << 20;
+
+    std::string strDirname;
+    //! Keys changed since the last Load or Write
+    std::set<K> setDirty;
+    //! The database may differ from the map outside setDirty
+    bool fAllDirty;
+
+public:
+    CFlatDBMap(const std::string& strDirnameIn) : strDirname(strDirnameIn), fAllDirty(true) {}
+
+    void SetDirty(const K& key)
+    {
+        if (!fAllDirty)
+            setDirty.insert(key);
+    }
+
+    void SetAllDirty()
+    {
+        fAllDirty = true;
+        setDirty.clear();
+    }
+
+    /** Add the stored entries to mapToLoad, entries it holds already are kept */
+    bool Load(std::map<K, V>& mapToLoad)
+    {
+        int64_t nStart = GetTimeMillis();
+        size_t nLoaded = 0;
+
+        for (const auto& pair : mapToLoad)
+            setDirty.insert(pair.first);
+        try {
+            CDBWrapper db(GetDataDir() / strDirname, nCacheSize);
+            std::unique_ptr<CDBIterator> pcursor(db.NewIterator());
+            for (pcursor->SeekToFirst(); pcursor->Valid(); pcursor->Next()) {
+                K key;
+                V value;
+                if (!pcursor->GetKey(key) || !pcursor->GetValue(value))
+                    return error("%s: Failed to read an entry of %s", __func__, strDirname);
+                nLoaded += mapToLoad.emplace(key, value).second;
+            }
+        }
+        catch (const std::exception& e) {
+            return error("%s: Database error - %s", __func__, e.what());
+        }
+        fAllDirty = false;
+
+        LogPrintf("Loaded %u entries from %s  %dms\n", nLoaded, strDirname, GetTimeMillis() - nStart);
+        return true;
+    }
+
+    bool Write(const std::map<K, V>& mapToSave)
+    {
+        int64_t nStart = GetTimeMillis();
+        size_t nWritten = 0;
+
+        try {
+            // whatever the database holds can't be trusted, start over
+            CDBWrapper db(GetDataDir() / strDirname, nCacheSize, false, fAllDirty);
+            CDBBatch batch(db);
+            if (fAllDirty) {
+                for (const auto& pair : mapToSave)
+                    batch.Write(pair.first, pair.second);
+                nWritten = mapToSave.size();
+            } else {
+                for (const auto& key : setDirty) {
+                    typename std::map<K, V>::const_iterator it = mapToSave.find(key);
+                    if (it == mapToSave.end())
+                        batch.Erase(key);
+                    else
+                        batch.Write(key, it->second);
+                }
+                nWritten = setDirty.size();
+            }
+            db.WriteBatch(batch, true);
+        }
+        catch (const std::exception& e) {
+            return error("%s: Database error - %s", __func__, e.what());
+        }
+        setDirty.clear();
+        fAllDirty = false;
+
+        LogPrintf("Written %u changed entries to %s  %dms\n", nWritten, strDirname, GetTimeMillis() - nStart);
+        return true;
+    }
+};
 
 #endif
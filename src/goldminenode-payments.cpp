@@ -8,6 +8,7 @@
 #include "goldminenode-sync.h"
 #include "goldminenodeman.h"
 #include "messagesigner.h"
+#include "net_processing.h"
 #include "netfulfilledman.h"
 #include "netmessagemaker.h"
 #include "spork.h"
@@ -20,6 +21,8 @@
 /** Object for who's going to get paid on which blocks */
 CGoldminenodePayments mnpayments;
 
+const std::string CGoldminenodePayments::SERIALIZATION_VERSION_STRING = "CGoldminenodePayments-Version-1";
+
 CCriticalSection cs_vecPayees;
 CCriticalSection cs_mapGoldminenodeBlocks;
 CCriticalSection cs_mapGoldminenodePaymentVotes;
@@ -182,7 +185,22 @@ void CGoldminenodePayments::Clear()
 {
     LOCK2(cs_mapGoldminenodeBlocks, cs_mapGoldminenodePaymentVotes);
     mapGoldminenodeBlocks.clear();
+    for (const auto& pair : mapGoldminenodePaymentVotes)
+        ForgetRelayPayload(CInv(MSG_GOLDMINENODE_PAYMENT_VOTE, pair.first));
     mapGoldminenodePaymentVotes.clear();
+    flatdbPaymentVotes.SetAllDirty();
+}
+
+bool CGoldminenodePayments::DumpPaymentVotes()
+{
+    LOCK(cs_mapGoldminenodePaymentVotes);
+    return flatdbPaymentVotes.Write(mapGoldminenodePaymentVotes);
+}
+
+bool CGoldminenodePayments::LoadPaymentVotes()
+{
+    LOCK(cs_mapGoldminenodePaymentVotes);
+    return flatdbPaymentVotes.Load(mapGoldminenodePaymentVotes);
 }
 
 bool CGoldminenodePayments::UpdateLastVote(const CGoldminenodePaymentVote& vote)
@@ -322,6 +340,7 @@ void CGoldminenodePayments::ProcessMessage(CNode* pfrom, const std::string& strC
             // Mark vote as non-verified when it's seen for the first time,
             // AddOrUpdatePaymentVote() below should take care of it if vote is actually ok
             res.first->second.MarkAsNotVerified();
+            flatdbPaymentVotes.SetDirty(nHash);
         }
 
         int nFirstBlock = nCachedBlockHeight - GetStorageLimit();
@@ -344,41 +363,62 @@ void CGoldminenodePayments::ProcessMessage(CNode* pfrom, const std::string& strC
             return;
         }
 
-        int nDos = 0;
-        if(!vote.CheckSignature(mnInfo.pubKeyGoldminenode, nCachedBlockHeight, nDos)) {
-            if(nDos) {
-                LOCK(cs_main);
-                LogPrintf("GOLDMINENODEPAYMENTVOTE -- ERROR: invalid signature\n");
-                Misbehaving(pfrom->GetId(), nDos);
-            } else {
-                // only warn about anything non-critical (i.e. nDos == 0) in debug mode
-                LogPrint("mnpayments", "GOLDMINENODEPAYMENTVOTE -- WARNING: invalid signature\n");
-            }
-            // Either our info or vote info could be outdated.
-            // In case our info is outdated, ask for an update,
-            mnodeman.AskForMN(pfrom, vote.goldminenodeOutpoint, connman);
-            // but there is nothing we can do if vote info itself is outdated
-            // (i.e. it was signed by a mn which changed its key),
-            // so just quit here.
-            return;
-        }
+        // Signature recovery is the expensive part, let the signature workers
+        // do it and finish the vote there. Keep a reference to the peer
+        // until then, the completion may need to punish or query it.
+        std::shared_ptr<int> pnDos = std::make_shared<int>(0);
+        int nValidationHeight = nCachedBlockHeight;
+        pfrom->AddRef();
+        messageSignatureQueue.Push(
+            [vote, mnInfo, nValidationHeight, pnDos]() {
+                return vote.CheckSignature(mnInfo.pubKeyGoldminenode, nValidationHeight, *pnDos);
+            },
+            [this, pfrom, vote, pnDos, &connman](bool fValid) {
+                ProcessVerifiedPaymentVote(pfrom, vote, fValid, *pnDos, connman);
+                pfrom->Release();
+            },
+            pfrom->GetId());
+    }
+}
 
-        if(!UpdateLastVote(vote)) {
-            LogPrintf("GOLDMINENODEPAYMENTVOTE -- goldminenode already voted, goldminenode=%s\n", vote.goldminenodeOutpoint.ToStringShort());
-            return;
+void CGoldminenodePayments::ProcessVerifiedPaymentVote(CNode* pfrom, const CGoldminenodePaymentVote& vote, bool fValidSignature, int nDos, CConnman& connman)
+{
+    uint256 nHash = vote.GetHash();
+
+    if(!fValidSignature) {
+        if(nDos) {
+            LOCK(cs_main);
+            LogPrintf("GOLDMINENODEPAYMENTVOTE -- ERROR: invalid signature\n");
+            Misbehaving(pfrom->GetId(), nDos);
+        } else {
+            // only warn about anything non-critical (i.e. nDos == 0) in debug mode
+            LogPrint("mnpayments", "GOLDMINENODEPAYMENTVOTE -- WARNING: invalid signature\n");
         }
+        // Either our info or vote info could be outdated.
+        // In case our info is outdated, ask for an update,
+        mnodeman.AskForMN(pfrom, vote.goldminenodeOutpoint, connman);
+        // but there is nothing we can do if vote info itself is outdated
+        // (i.e. it was signed by a mn which changed its key),
+        // so just quit here.
+        return;
+    }
 
-        CTxDestination address1;
-        ExtractDestination(vote.payee, address1);
-        CBitcoinAddress address2(address1);
+    if(!UpdateLastVote(vote)) {
+        LogPrintf("GOLDMINENODEPAYMENTVOTE -- goldminenode already voted, goldminenode=%s\n", vote.goldminenodeOutpoint.ToStringShort());
+        return;
+    }
 
-        LogPrint("mnpayments", "GOLDMINENODEPAYMENTVOTE -- vote: address=%s, nBlockHeight=%d, nHeight=%d, prevout=%s, hash=%s new\n",
-                    address2.ToString(), vote.nBlockHeight, nCachedBlockHeight, vote.goldminenodeOutpoint.ToStringShort(), nHash.ToString());
+    CTxDestination address1;
+    ExtractDestination(vote.payee, address1);
+    CBitcoinAddress address2(address1);
 
-        if(AddOrUpdatePaymentVote(vote)){
-            vote.Relay(connman);
-            goldminenodeSync.BumpAssetLastTime("GOLDMINENODEPAYMENTVOTE");
-        }
+    LogPrint("mnpayments", "GOLDMINENODEPAYMENTVOTE -- vote: address=%s, nBlockHeight=%d, nHeight=%d, prevout=%s, hash=%s new\n",
+                address2.ToString(), vote.nBlockHeight, nCachedBlockHeight, vote.goldminenodeOutpoint.ToStringShort(), nHash.ToString());
+
+    if(AddOrUpdatePaymentVote(vote)){
+        vote.Relay(connman);
+        goldminenodeSync.BumpAssetLastTime("GOLDMINENODEPAYMENTVOTE");
+        goldminenodeSync.CheckAssetCompleted(connman);
     }
 }
 
@@ -475,6 +515,7 @@ bool CGoldminenodePayments::AddOrUpdatePaymentVote(const CGoldminenodePaymentVot
     LOCK2(cs_mapGoldminenodeBlocks, cs_mapGoldminenodePaymentVotes);
 
     mapGoldminenodePaymentVotes[nVoteHash] = vote;
+    flatdbPaymentVotes.SetDirty(nVoteHash);
 
     auto it = mapGoldminenodeBlocks.emplace(vote.nBlockHeight, CGoldminenodeBlockPayees(vote.nBlockHeight)).first;
     it->second.AddPayee(vote);
@@ -551,11 +592,8 @@ bool CGoldminenodeBlockPayees::IsTransactionValid(const CTransaction& txNew) con
 	CAmount nGoldminenodePayment;
 	if( sporkManager.IsSporkActive(SPORK_18_EVOLUTION_PAYMENTS) ){
 		CScript payeeEvo;
-        std::string addr = evolutionManager.getEvolution(nBlockHeight);
-        if(!addr.empty())
+        if(evolutionManager.getEvolutionScript(nBlockHeight, payeeEvo))
         {
-		    CBitcoinAddress address( evolutionManager.getEvolution(nBlockHeight) );
-		    payeeEvo = GetScriptForDestination( address.Get() );
 		    nGoldminenodePayment = GetGoldminenodePayment(nBlockHeight, txNew.GetValueOutWOEvol(payeeEvo));
         }
 	}else{
@@ -655,6 +693,8 @@ void CGoldminenodePayments::CheckAndRemove()
 
         if(nCachedBlockHeight - vote.nBlockHeight > nLimit) {
             LogPrint("mnpayments", "CGoldminenodePayments::CheckAndRemove -- Removing old Goldminenode payment: nBlockHeight=%d\n", vote.nBlockHeight);
+            ForgetRelayPayload(CInv(MSG_GOLDMINENODE_PAYMENT_VOTE, it->first));
+            flatdbPaymentVotes.SetDirty(it->first);
             mapGoldminenodePaymentVotes.erase(it++);
             mapGoldminenodeBlocks.erase(vote.nBlockHeight);
         } else {
@@ -770,7 +810,7 @@ void CGoldminenodePayments::CheckBlockVotes(int nBlockHeight)
     if (!goldminenodeSync.IsWinnersListSynced()) return;
 
     CGoldminenodeMan::rank_pair_vec_t mns;
-    if (!mnodeman.GetGoldminenodeRanks(mns, nBlockHeight - 101, GetMinGoldminenodePaymentsProto())) {
+    if (!mnodeman.GetGoldminenodeRanks(mns, nBlockHeight - 101, GetMinGoldminenodePaymentsProto(), MNPAYMENTS_SIGNATURES_TOTAL)) {
         LogPrintf("CGoldminenodePayments::CheckBlockVotes -- nBlockHeight=%d, GetGoldminenodeRanks failed\n", nBlockHeight);
         return;
     }
@@ -1032,6 +1072,23 @@ bool CGoldminenodePayments::IsEnoughData() const
     return GetBlockCount() > nStorageLimit && GetVoteCount() > nStorageLimit * nAverageVotes;
 }
 
+int CGoldminenodePayments::CountUpcomingVerifiedVotes() const
+{
+    LOCK(cs_mapGoldminenodeBlocks);
+
+    int nCount = 0;
+    for(int h = nCachedBlockHeight; h < nCachedBlockHeight + 20; h++) {
+        const auto it = mapGoldminenodeBlocks.find(h);
+        if(it == mapGoldminenodeBlocks.end()) continue;
+        for (const auto& payee : it->second.vecPayees) {
+            for (const auto& hash : payee.GetVoteHashes()) {
+                if(HasVerifiedPaymentVote(hash)) nCount++;
+            }
+        }
+    }
+    return nCount;
+}
+
 int CGoldminenodePayments::GetStorageLimit() const
 {
     return std::max(int(mnodeman.size() * nStorageCoeff), nMinBlocksToStore);
@@ -1046,19 +1103,11 @@ void CGoldminenodePayments::CreateEvolution( CMutableTransaction& txNewRet, int
 {	
     // make sure it's empty, just in case
     voutSuperblockRet.clear();
-	std::string addr = evolutionManager.getEvolution(nBlockHeight);
-    LogPrintf("CreateEvolution for node %s\n",addr.c_str());
-    if(addr.empty()) // if node is empty then going out
-        return;
-    
 	CScript payeeEvo;
-	CPubKey pb;
+	if(!evolutionManager.getEvolutionScript(nBlockHeight, payeeEvo)) // if node is empty then going out
+		return;
+	LogPrintf("CreateEvolution for node %s\n", ScriptToAsmStr(payeeEvo));
 
-	CBitcoinAddress address(addr);
-
-	//--.
-	payeeEvo = GetScriptForDestination( address.Get() );
-	
 	CTxOut txout = CTxOut(  blockEvolution, payeeEvo );
 	
 	txNewRet.vout.push_back( txout );
@@ -7,6 +7,7 @@
 
 #include "util.h"
 #include "core_io.h"
+#include "flat-database.h"
 #include "key.h"
 #include "goldminenode.h"
 #include "net_processing.h"
@@ -28,7 +29,7 @@ static const int MIN_GOLDMINENODE_PAYMENT_PROTO_VERSION_2 = 70210;
 
 extern CCriticalSection cs_vecPayees;
 extern CCriticalSection cs_mapGoldminenodeBlocks;
-extern CCriticalSection cs_mapGoldminenodePayeeVotes;
+extern CCriticalSection cs_mapGoldminenodePaymentVotes;
 
 extern CGoldminenodePayments mnpayments;
 
@@ -186,24 +187,46 @@ private:
     // Keep track of current block height
     int nCachedBlockHeight;
 
+    // On disk copy of mapGoldminenodePaymentVotes, guarded by cs_mapGoldminenodePaymentVotes
+    CFlatDBMap<uint256, CGoldminenodePaymentVote> flatdbPaymentVotes;
+
 public:
+    static const std::string SERIALIZATION_VERSION_STRING;
+
     std::map<uint256, CGoldminenodePaymentVote> mapGoldminenodePaymentVotes;
     std::map<int, CGoldminenodeBlockPayees> mapGoldminenodeBlocks;
     std::map<COutPoint, int> mapGoldminenodesLastVote;
     std::map<COutPoint, int> mapGoldminenodesDidNotVote;
 
-    CGoldminenodePayments() : nStorageCoeff(1.25), nMinBlocksToStore(6000) {}
+    CGoldminenodePayments() : nStorageCoeff(1.25), nMinBlocksToStore(6000), flatdbPaymentVotes("mnpaymentvotes") {}
 
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
-        READWRITE(mapGoldminenodePaymentVotes);
+        std::string strVersion;
+        if(ser_action.ForRead()) {
+            READWRITE(strVersion);
+        }
+        else {
+            strVersion = SERIALIZATION_VERSION_STRING;
+            READWRITE(strVersion);
+        }
+
+        // the votes are kept in their own database, see DumpPaymentVotes()
         READWRITE(mapGoldminenodeBlocks);
+        if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
+            Clear();
+        }
     }
 
     void Clear();
 
+    /// Write the payment votes changed since the last load or dump to their database
+    bool DumpPaymentVotes();
+    /// Read the payment votes written by DumpPaymentVotes(), call after mnpayments.dat was loaded
+    bool LoadPaymentVotes();
+
     bool AddOrUpdatePaymentVote(const CGoldminenodePaymentVote& vote);
     bool HasVerifiedPaymentVote(const uint256& hashIn) const;
     bool ProcessBlock(int nBlockHeight, CConnman& connman);
@@ -220,6 +243,8 @@ public:
     bool UpdateLastVote(const CGoldminenodePaymentVote& vote);
 
     int GetMinGoldminenodePaymentsProto() const;
+    /// Finish handling a payment vote once its signature was checked
+    void ProcessVerifiedPaymentVote(CNode* pfrom, const CGoldminenodePaymentVote& vote, bool fValidSignature, int nDos, CConnman& connman);
     void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
     std::string GetRequiredPaymentsString(int nBlockHeight) const;
     void FillBlockPayee(CMutableTransaction& txNew, int nBlockHeight, CAmount blockReward, CTxOut& txoutGoldminenodeRet) const;
@@ -229,6 +254,8 @@ public:
     int GetVoteCount() const { return mapGoldminenodePaymentVotes.size(); }
 
     bool IsEnoughData() const;
+    /// Verified votes for the blocks Sync() reports, to compare with the counts peers announce
+    int CountUpcomingVerifiedVotes() const;
     int GetStorageLimit() const;
 	static void CreateEvolution(CMutableTransaction& txNewRet, int nBlockHeight, CAmount blockEvolution, std::vector<CTxOut>& voutSuperblockRet);	
 	
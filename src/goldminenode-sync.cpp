@@ -31,6 +31,8 @@ void CGoldminenodeSync::Reset()
     nTimeAssetSyncStarted = GetTime();
     nTimeLastBumped = GetTime();
     nTimeLastFailure = 0;
+    mapAssetAnnouncedCounts.clear();
+    nLastTickAsset = GOLDMINENODE_SYNC_FAILED;
 }
 
 void CGoldminenodeSync::BumpAssetLastTime(const std::string& strFuncName)
@@ -56,42 +58,104 @@ std::string CGoldminenodeSync::GetAssetName()
 
 void CGoldminenodeSync::SwitchToNextAsset(CConnman& connman)
 {
-    switch(nRequestedGoldminenodeAssets)
+    int nAsset;
     {
-        case(GOLDMINENODE_SYNC_FAILED):
-            throw std::runtime_error("Can't switch to next asset from failed, should use Reset() first!");
-            break;
-        case(GOLDMINENODE_SYNC_INITIAL):
-            nRequestedGoldminenodeAssets = GOLDMINENODE_SYNC_WAITING;
-            LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Starting %s\n", GetAssetName());
-            break;
-        case(GOLDMINENODE_SYNC_WAITING):
-            LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Completed %s in %llds\n", GetAssetName(), GetTime() - nTimeAssetSyncStarted);
-            nRequestedGoldminenodeAssets = GOLDMINENODE_SYNC_LIST;
-            LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Starting %s\n", GetAssetName());
-            break;
-        case(GOLDMINENODE_SYNC_LIST):
-            LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Completed %s in %llds\n", GetAssetName(), GetTime() - nTimeAssetSyncStarted);
-            nRequestedGoldminenodeAssets = GOLDMINENODE_SYNC_MNW;
-            LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Starting %s\n", GetAssetName());
-            break;
-        case(GOLDMINENODE_SYNC_MNW):
-            LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Completed %s in %llds\n", GetAssetName(), GetTime() - nTimeAssetSyncStarted);
-            nRequestedGoldminenodeAssets = GOLDMINENODE_SYNC_FINISHED;
-            uiInterface.NotifyAdditionalDataSyncProgressChanged(1);
-            //try to activate our goldminenode if possible
-            activeGoldminenode.ManageState(connman);
+        LOCK(cs);
+        nAsset = nRequestedGoldminenodeAssets;
+    }
+    SwitchFromAsset(nAsset, connman);
+}
 
-            connman.ForEachNode(CConnman::AllNodes, [](CNode* pnode) {
-                netfulfilledman.AddFulfilledRequest(pnode->addr, "full-sync");
-            });
-            LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Sync has finished\n");
+bool CGoldminenodeSync::SwitchFromAsset(int nAsset, CConnman& connman)
+{
+    {
+        LOCK(cs);
+        if(nAsset != nRequestedGoldminenodeAssets) return false;
+        switch(nRequestedGoldminenodeAssets)
+        {
+            case(GOLDMINENODE_SYNC_FAILED):
+                throw std::runtime_error("Can't switch to next asset from failed, should use Reset() first!");
+                break;
+            case(GOLDMINENODE_SYNC_INITIAL):
+                nRequestedGoldminenodeAssets = GOLDMINENODE_SYNC_WAITING;
+                LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Starting %s\n", GetAssetName());
+                break;
+            case(GOLDMINENODE_SYNC_WAITING):
+                LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Completed %s in %llds\n", GetAssetName(), GetTime() - nTimeAssetSyncStarted);
+                nRequestedGoldminenodeAssets = GOLDMINENODE_SYNC_LIST;
+                LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Starting %s\n", GetAssetName());
+                break;
+            case(GOLDMINENODE_SYNC_LIST):
+                LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Completed %s in %llds\n", GetAssetName(), GetTime() - nTimeAssetSyncStarted);
+                nRequestedGoldminenodeAssets = GOLDMINENODE_SYNC_MNW;
+                LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Starting %s\n", GetAssetName());
+                break;
+            case(GOLDMINENODE_SYNC_MNW):
+                LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Completed %s in %llds\n", GetAssetName(), GetTime() - nTimeAssetSyncStarted);
+                nRequestedGoldminenodeAssets = GOLDMINENODE_SYNC_FINISHED;
+                break;
+        }
+        nRequestedGoldminenodeAttempt = 0;
+        mapAssetAnnouncedCounts.clear();
+        nTimeAssetSyncStarted = GetTime();
+        BumpAssetLastTime("CGoldminenodeSync::SwitchToNextAsset");
+    }
 
-            break;
+    // the rest takes other locks, cs must not be held for it
+    if(nAsset == GOLDMINENODE_SYNC_MNW) {
+        uiInterface.NotifyAdditionalDataSyncProgressChanged(1);
+        //try to activate our goldminenode if possible
+        activeGoldminenode.ManageState(connman);
+
+        connman.ForEachNode(CConnman::AllNodes, [](CNode* pnode) {
+            netfulfilledman.AddFulfilledRequest(pnode->addr, "full-sync");
+        });
+        LogPrintf("CGoldminenodeSync::SwitchToNextAsset -- Sync has finished\n");
+    }
+    return true;
+}
+
+int CGoldminenodeSync::CountAssetItems(int nAsset)
+{
+    switch(nAsset)
+    {
+        case(GOLDMINENODE_SYNC_LIST):         return mnodeman.size();
+        case(GOLDMINENODE_SYNC_MNW):          return mnpayments.CountUpcomingVerifiedVotes();
+        default:                            return -1;
+    }
+}
+
+void CGoldminenodeSync::AnnounceAssetCount(int nItemID, int nCount, NodeId nPeer)
+{
+    LOCK(cs);
+    // counts for an asset we are not syncing are stale, an empty peer tells us nothing
+    if(nItemID != nRequestedGoldminenodeAssets || nCount <= 0) return;
+    mapAssetAnnouncedCounts[nPeer] = nCount;
+}
+
+void CGoldminenodeSync::CheckAssetCompleted(CConnman& connman)
+{
+    int nAsset;
+    int nAnnouncedCount = -1;
+    {
+        LOCK(cs);
+        // a single peer could announce any count, only trust what several of them agree on
+        if((int)mapAssetAnnouncedCounts.size() < GOLDMINENODE_SYNC_ENOUGH_PEERS) return;
+        nAsset = nRequestedGoldminenodeAssets;
+        // the best informed peer decides what "complete" means
+        for (const auto& pair : mapAssetAnnouncedCounts) {
+            nAnnouncedCount = std::max(nAnnouncedCount, pair.second);
+        }
+    }
+
+    // counting takes the locks of the goldminenode list or the payments
+    int nItems = CountAssetItems(nAsset);
+    if(nItems < nAnnouncedCount) return;
+
+    // another thread might have switched already while we were counting
+    if(SwitchFromAsset(nAsset, connman)) {
+        LogPrintf("CGoldminenodeSync::CheckAssetCompleted -- got %d of %d announced items\n", nItems, nAnnouncedCount);
     }
-    nRequestedGoldminenodeAttempt = 0;
-    nTimeAssetSyncStarted = GetTime();
-    BumpAssetLastTime("CGoldminenodeSync::SwitchToNextAsset");
 }
 
 std::string CGoldminenodeSync::GetSyncStatus()
@@ -107,7 +171,7 @@ std::string CGoldminenodeSync::GetSyncStatus()
     }
 }
 
-void CGoldminenodeSync::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv)
+void CGoldminenodeSync::ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman)
 {
     if (strCommand == NetMsgType::SYNCSTATUSCOUNT) { //Sync status count
 
@@ -119,6 +183,10 @@ void CGoldminenodeSync::ProcessMessage(CNode* pfrom, const std::string& strComma
         vRecv >> nItemID >> nCount;
 
         LogPrintf("SYNCSTATUSCOUNT -- got inventory count: nItemID=%d  nCount=%d  peer=%d\n", nItemID, nCount, pfrom->id);
+
+        // ssc is sent after the invs, we might have everything already
+        AnnounceAssetCount(nItemID, nCount, pfrom->id);
+        CheckAssetCompleted(connman);
     }
 }
 
@@ -137,12 +205,14 @@ void CGoldminenodeSync::ProcessTick(CConnman& connman)
         return;
     }
 
-    if(GetTime() - nTimeLastProcess < GOLDMINENODE_SYNC_TICK_SECONDS) {
+    // a freshly started asset sends its requests right away, ticks only pace the retries
+    if(GetTime() - nTimeLastProcess < GOLDMINENODE_SYNC_TICK_SECONDS && nLastTickAsset == nRequestedGoldminenodeAssets) {
         // too early, nothing to do here
         return;
     }
 
     nTimeLastProcess = GetTime();
+    nLastTickAsset = nRequestedGoldminenodeAssets;
 
     // reset sync status in case of any other sync failure
     if(IsFailed()) {
@@ -168,6 +238,30 @@ void CGoldminenodeSync::ProcessTick(CConnman& connman)
 
     std::vector<CNode*> vNodesCopy = connman.CopyNodeVector(CConnman::FullyConnectedOnly);
 
+    if(nRequestedGoldminenodeAssets == GOLDMINENODE_SYNC_WAITING) {
+        // no need to wait for the timeout when enough outbound peers are not ahead of us
+        int nHeight;
+        {
+            LOCK(cs_main);
+            nHeight = chainActive.Height();
+        }
+        int nPeersBehind = 0;
+        bool fPeerAhead = false;
+        for (const auto& pnode : vNodesCopy) {
+            if(pnode->fInbound || pnode->fGoldminenode) continue;
+            if(pnode->nStartingHeight > nHeight) {
+                fPeerAhead = true;
+                break;
+            }
+            nPeersBehind++;
+        }
+        if(!fPeerAhead && nPeersBehind >= GOLDMINENODE_SYNC_ENOUGH_PEERS) {
+            LogPrintf("CGoldminenodeSync::ProcessTick -- nTick %d nRequestedGoldminenodeAssets %d -- %d peers are not ahead of height %d\n", nTick, nRequestedGoldminenodeAssets, nPeersBehind, nHeight);
+            SwitchToNextAsset(connman);
+            nLastTickAsset = nRequestedGoldminenodeAssets;
+        }
+    }
+
     for (auto& pnode : vNodesCopy)
     {
         CNetMsgMaker msgMaker(pnode->GetSendVersion());
@@ -241,6 +335,17 @@ void CGoldminenodeSync::ProcessTick(CConnman& connman)
                     return;
                 }
 
+                // try to get the whole list in one message first, peers which
+                // don't support snapshots ignore it and get a dseg next time
+                if(!netfulfilledman.HasFulfilledRequest(pnode->addr, "goldminenode-list-snapshot")) {
+                    netfulfilledman.AddFulfilledRequest(pnode->addr, "goldminenode-list-snapshot");
+                    if (pnode->nVersion >= mnpayments.GetMinGoldminenodePaymentsProto()) {
+                        mnodeman.RequestListSnapshot(pnode, connman);
+                        connman.ReleaseNodeVector(vNodesCopy);
+                        return;
+                    }
+                }
+
                 // only request once from each peer
                 if(netfulfilledman.HasFulfilledRequest(pnode->addr, "goldminenode-list-sync")) continue;
                 netfulfilledman.AddFulfilledRequest(pnode->addr, "goldminenode-list-sync");
@@ -6,9 +6,12 @@
 
 #include "chain.h"
 #include "net.h"
+#include "sync.h"
 
 #include <univalue.h>
 
+#include <map>
+
 class CGoldminenodeSync;
 
 static const int GOLDMINENODE_SYNC_FAILED          = -1;
@@ -46,8 +49,19 @@ private:
     int64_t nTimeLastBumped;
     // ... or failed
     int64_t nTimeLastFailure;
+    // Item counts peers announced for the current asset, the latest one of each peer
+    std::map<NodeId, int> mapAssetAnnouncedCounts;
+    // Asset the last tick worked on, a freshly started asset doesn't wait for the next tick
+    int nLastTickAsset;
+
+    // Serializes moving between assets, sync events come from several threads
+    CCriticalSection cs;
 
     void Fail();
+    /// Number of items we have for nAsset, comparable to the counts peers announce, -1 if not countable
+    int CountAssetItems(int nAsset);
+    /// Move on from nAsset unless another thread did already, returns whether we switched
+    bool SwitchFromAsset(int nAsset, CConnman& connman);
 
 public:
     CGoldminenodeSync() { Reset(); }
@@ -70,8 +84,12 @@ public:
 
     void Reset();
     void SwitchToNextAsset(CConnman& connman);
+    /// Peer nPeer told us how many items it has for nItemID, either by ssc or by sending them in bulk
+    void AnnounceAssetCount(int nItemID, int nCount, NodeId nPeer);
+    /// Move on as soon as enough peers announced counts for the current asset and we have as many items as the largest of them
+    void CheckAssetCompleted(CConnman& connman);
 
-    void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv);
+    void ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStream& vRecv, CConnman& connman);
     void ProcessTick(CConnman& connman);
 
     void AcceptedBlockHeader(const CBlockIndex *pindexNew);
@@ -12,6 +12,7 @@
 #include "goldminenode-sync.h"
 #include "goldminenodeman.h"
 #include "messagesigner.h"
+#include "net_processing.h"
 #include "script/standard.h"
 #include "util.h"
 #ifdef ENABLE_WALLET
@@ -74,6 +75,7 @@ bool CGoldminenode::UpdateFromNewBroadcast(CGoldminenodeBroadcast& mnb, CConnman
     int nDos = 0;
     if(!mnb.lastPing || (mnb.lastPing && mnb.lastPing.CheckAndUpdate(this, true, nDos, connman))) {
         lastPing = mnb.lastPing;
+        LOCK(mnodeman.cs_mapSeenMessages);
         mnodeman.mapSeenGoldminenodePing.insert(std::make_pair(lastPing.GetHash(), lastPing));
     }
     // if it matches our Goldminenode privkey...
@@ -576,7 +578,10 @@ bool CGoldminenodeBroadcast::CheckOutpoint(int& nDos)
                 Params().GetConsensus().nGoldminenodeMinimumConfirmations, outpoint.ToStringShort());
         // UTXO is legit but has not enough confirmations.
         // Maybe we miss few blocks, let this mnb be checked again later.
+        LOCK(mnodeman.cs_mapSeenMessages);
         mnodeman.mapSeenGoldminenodeBroadcast.erase(GetHash());
+        mnodeman.flatdbSeenGoldminenodeBroadcast.SetDirty(GetHash());
+        ForgetRelayPayload(CInv(MSG_GOLDMINENODE_ANNOUNCE, GetHash()));
         return false;
     }
 
@@ -741,11 +746,10 @@ uint256 CGoldminenodePing::GetSignatureHash() const
 
 CGoldminenodePing::CGoldminenodePing(const COutPoint& outpoint)
 {
-    LOCK(cs_main);
-    if (!chainActive.Tip() || chainActive.Height() < 12) return;
+    int nHeight = GetActiveChainHeight();
+    if (nHeight < 12 || !GetBlockHash(blockHash, nHeight - 12)) return;
 
     goldminenodeOutpoint = outpoint;
-    blockHash = chainActive[chainActive.Height() - 12]->GetBlockHash();
     sigTime = GetAdjustedTime();
     nDaemonVersion = CLIENT_VERSION;
 }
@@ -911,8 +915,13 @@ bool CGoldminenodePing::CheckAndUpdate(CGoldminenode* pmn, bool fFromNewBroadcas
     // and update mnodeman.mapSeenGoldminenodeBroadcast.lastPing which is probably outdated
     CGoldminenodeBroadcast mnb(*pmn);
     uint256 hash = mnb.GetHash();
-    if (mnodeman.mapSeenGoldminenodeBroadcast.count(hash)) {
-        mnodeman.mapSeenGoldminenodeBroadcast[hash].second.lastPing = *this;
+    {
+        LOCK(mnodeman.cs_mapSeenMessages);
+        if (mnodeman.mapSeenGoldminenodeBroadcast.count(hash)) {
+            mnodeman.mapSeenGoldminenodeBroadcast[hash].second.lastPing = *this;
+            mnodeman.flatdbSeenGoldminenodeBroadcast.SetDirty(hash);
+            ForgetRelayPayload(CInv(MSG_GOLDMINENODE_ANNOUNCE, hash));
+        }
     }
 
     // force update, ignoring cache
@@ -10,6 +10,7 @@
 #include "goldminenode-sync.h"
 #include "goldminenodeman.h"
 #include "messagesigner.h"
+#include "net_processing.h"
 #include "netfulfilledman.h"
 #include "netmessagemaker.h"
 #ifdef ENABLE_WALLET
@@ -18,23 +19,15 @@
 #include "script/standard.h"
 #include "ui_interface.h"
 #include "util.h"
+#include "validationinterface.h"
 #include "warnings.h"
 
 /** Goldminenode manager */
 CGoldminenodeMan mnodeman;
 
-const std::string CGoldminenodeMan::SERIALIZATION_VERSION_STRING = "CGoldminenodeMan-Version-8";
+const std::string CGoldminenodeMan::SERIALIZATION_VERSION_STRING = "CGoldminenodeMan-Version-9";
 const int CGoldminenodeMan::LAST_PAID_SCAN_BLOCKS = 100;
 
-struct CompareLastPaidBlock
-{
-    bool operator()(const std::pair<int, const CGoldminenode*>& t1,
-                    const std::pair<int, const CGoldminenode*>& t2) const
-    {
-        return (t1.first != t2.first) ? (t1.first < t2.first) : (t1.second->outpoint < t2.second->outpoint);
-    }
-};
-
 struct CompareScoreMN
 {
     bool operator()(const std::pair<arith_uint256, const CGoldminenode*>& t1,
@@ -54,20 +47,38 @@ struct CompareByAddr
     }
 };
 
+uint256 CGoldminenodeListSnapshot::CalcCommitment() const
+{
+    // not the peer's version, 70209 peers get the old outpoint format.
+    // Goldminenode objects peek at the stream size, CHashWriter can't serve them directly.
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
+    ss << nVersion << nHeight << vecBroadcasts;
+    return Hash(ss.begin(), ss.end());
+}
+
 CGoldminenodeMan::CGoldminenodeMan():
     cs(),
     mapGoldminenodes(),
     mAskedUsForGoldminenodeList(),
     mWeAskedForGoldminenodeList(),
     mWeAskedForGoldminenodeListEntry(),
+    mAskedUsForListSnapshot(),
+    mWeAskedForListSnapshot(),
     mWeAskedForVerification(),
     mMnbRecoveryRequests(),
     mMnbRecoveryGoodReplies(),
     listScheduledMnbRequestConnections(),
+    mapRankCache(MAX_RANK_CACHE_SIZE),
+    setPaymentQueue(),
+    fPaymentQueueDirty(true),
+    mapCollateralHeights(),
+    pListSnapshot(),
+    nListSnapshotTime(0),
     fGoldminenodesAdded(false),
     fGoldminenodesRemoved(false),
     nLastSentinelPingTime(0),
     mapSeenGoldminenodeBroadcast(),
+    flatdbSeenGoldminenodeBroadcast("mnbroadcasts"),
     mapSeenGoldminenodePing(),
     nDsqCount(0)
 {}
@@ -80,6 +91,7 @@ bool CGoldminenodeMan::Add(CGoldminenode &mn)
 
     LogPrint("goldminenode", "CGoldminenodeMan::Add -- Adding new Goldminenode: addr=%s, %i now\n", mn.addr.ToString(), size() + 1);
     mapGoldminenodes[mn.outpoint] = mn;
+    InvalidateListCaches();
     fGoldminenodesAdded = true;
     return true;
 }
@@ -196,11 +208,18 @@ void CGoldminenodeMan::CheckAndRemove(CConnman& connman)
                 LogPrint("goldminenode", "CGoldminenodeMan::CheckAndRemove -- Removing Goldminenode: %s  addr=%s  %i now\n", it->second.GetStateString(), it->second.addr.ToString(), size() - 1);
 
                 // erase all of the broadcasts we've seen from this txin, ...
-                mapSeenGoldminenodeBroadcast.erase(hash);
+                {
+                    LOCK(cs_mapSeenMessages);
+                    mapSeenGoldminenodeBroadcast.erase(hash);
+                    flatdbSeenGoldminenodeBroadcast.SetDirty(hash);
+                }
+                ForgetRelayPayload(CInv(MSG_GOLDMINENODE_ANNOUNCE, hash));
                 mWeAskedForGoldminenodeListEntry.erase(it->first);
+                mapCollateralHeights.erase(it->first);
 
                 // and finally remove it from the list
                 mapGoldminenodes.erase(it++);
+                InvalidateListCaches();
                 fGoldminenodesRemoved = true;
             } else {
                 bool fAsk = (nAskForMnbRecovery > 0) &&
@@ -294,6 +313,26 @@ void CGoldminenodeMan::CheckAndRemove(CConnman& connman)
             }
         }
 
+        // check who's asked us for a list snapshot
+        it1 = mAskedUsForListSnapshot.begin();
+        while(it1 != mAskedUsForListSnapshot.end()){
+            if((*it1).second < GetTime()){
+                mAskedUsForListSnapshot.erase(it1++);
+            } else {
+                ++it1;
+            }
+        }
+
+        // check who we asked for a list snapshot
+        it1 = mWeAskedForListSnapshot.begin();
+        while(it1 != mWeAskedForListSnapshot.end()){
+            if((*it1).second < GetTime()){
+                mWeAskedForListSnapshot.erase(it1++);
+            } else {
+                ++it1;
+            }
+        }
+
         // check which Goldminenodes we've asked for
         auto it2 = mWeAskedForGoldminenodeListEntry.begin();
         while(it2 != mWeAskedForGoldminenodeListEntry.end()){
@@ -323,11 +362,14 @@ void CGoldminenodeMan::CheckAndRemove(CConnman& connman)
 
         // NOTE: do not expire mapSeenGoldminenodeBroadcast entries here, clean them on mnb updates!
 
+        LOCK(cs_mapSeenMessages);
+
         // remove expired mapSeenGoldminenodePing
         std::map<uint256, CGoldminenodePing>::iterator it4 = mapSeenGoldminenodePing.begin();
         while(it4 != mapSeenGoldminenodePing.end()){
             if((*it4).second.IsExpired()) {
                 LogPrint("goldminenode", "CGoldminenodeMan::CheckAndRemove -- Removing expired Goldminenode ping: hash=%s\n", (*it4).second.GetHash().ToString());
+                ForgetRelayPayload(CInv(MSG_GOLDMINENODE_PING, it4->first));
                 mapSeenGoldminenodePing.erase(it4++);
             } else {
                 ++it4;
@@ -339,6 +381,7 @@ void CGoldminenodeMan::CheckAndRemove(CConnman& connman)
         while(itv2 != mapSeenGoldminenodeVerification.end()){
             if((*itv2).second.nBlockHeight < nCachedBlockHeight - MAX_POSE_BLOCKS){
                 LogPrint("goldminenode", "CGoldminenodeMan::CheckAndRemove -- Removing expired Goldminenode verification: hash=%s\n", (*itv2).first.ToString());
+                ForgetRelayPayload(CInv(MSG_GOLDMINENODE_VERIFY, itv2->first));
                 mapSeenGoldminenodeVerification.erase(itv2++);
             } else {
                 ++itv2;
@@ -355,17 +398,32 @@ void CGoldminenodeMan::CheckAndRemove(CConnman& connman)
 
 void CGoldminenodeMan::Clear()
 {
-    LOCK(cs);
+    LOCK2(cs, cs_mapSeenMessages);
     mapGoldminenodes.clear();
+    mapCollateralHeights.clear();
+    InvalidateListCaches();
     mAskedUsForGoldminenodeList.clear();
     mWeAskedForGoldminenodeList.clear();
     mWeAskedForGoldminenodeListEntry.clear();
+    mAskedUsForListSnapshot.clear();
+    mWeAskedForListSnapshot.clear();
+    for (const auto& pair : mapSeenGoldminenodeBroadcast)
+        ForgetRelayPayload(CInv(MSG_GOLDMINENODE_ANNOUNCE, pair.first));
     mapSeenGoldminenodeBroadcast.clear();
+    flatdbSeenGoldminenodeBroadcast.SetAllDirty();
+    for (const auto& pair : mapSeenGoldminenodePing)
+        ForgetRelayPayload(CInv(MSG_GOLDMINENODE_PING, pair.first));
     mapSeenGoldminenodePing.clear();
     nDsqCount = 0;
     nLastSentinelPingTime = 0;
 }
 
+bool CGoldminenodeMan::DumpSeenBroadcasts()
+{
+    LOCK(cs_mapSeenMessages);
+    return flatdbSeenGoldminenodeBroadcast.Write(mapSeenGoldminenodeBroadcast);
+}
+
 int CGoldminenodeMan::CountGoldminenodes(int nProtocolVersion)
 {
     LOCK(cs);
@@ -503,12 +561,12 @@ bool CGoldminenodeMan::Has(const COutPoint& outpoint)
 //
 // Deterministically select the oldest/best goldminenode to pay on the network
 //
-bool CGoldminenodeMan::GetNextGoldminenodeInQueueForPayment(bool fFilterSigTime, int& nCountRet, goldminenode_info_t& mnInfoRet)
+bool CGoldminenodeMan::GetNextGoldminenodeInQueueForPayment(bool fFilterSigTime, int& nCountRet, goldminenode_info_t& mnInfoRet, bool fCountAll)
 {
-    return GetNextGoldminenodeInQueueForPayment(nCachedBlockHeight, fFilterSigTime, nCountRet, mnInfoRet);
+    return GetNextGoldminenodeInQueueForPayment(nCachedBlockHeight, fFilterSigTime, nCountRet, mnInfoRet, fCountAll);
 }
 
-bool CGoldminenodeMan::GetNextGoldminenodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCountRet, goldminenode_info_t& mnInfoRet)
+bool CGoldminenodeMan::GetNextGoldminenodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCountRet, goldminenode_info_t& mnInfoRet, bool fCountAll)
 {
     mnInfoRet = goldminenode_info_t();
     nCountRet = 0;
@@ -521,62 +579,75 @@ bool CGoldminenodeMan::GetNextGoldminenodeInQueueForPayment(int nBlockHeight, bo
     // Need LOCK2 here to ensure consistent locking order because the GetBlockHash call below locks cs_main
     LOCK2(cs_main,cs);
 
-    std::vector<std::pair<int, const CGoldminenode*> > vecGoldminenodeLastPaid;
+    if (fPaymentQueueDirty) {
+        RebuildPaymentQueue();
+    }
+
+    int nMnCount = CountGoldminenodes();
+
+    // Look at 1/10 of the oldest nodes (by last payment), calculate their scores and pay the best one
+    //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
+    //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
+    //  -- (chance per block * chances before IsScheduled will fire)
+    int nTenthNetwork = std::max(1, nMnCount/10);
 
     /*
-        Make a vector with all of the last paid times
+        Walk the queue from the oldest payment on, keeping the first tenth of the
+        network for scoring. The rest is only walked as far as we need to count.
     */
 
-    int nMnCount = CountGoldminenodes();
+    std::vector<const CGoldminenode*> vecCandidates;
 
-    for (const auto& mnpair : mapGoldminenodes) {
-        if(!mnpair.second.IsValidForPayment()) continue;
+    for (const auto& lastpaid : setPaymentQueue) {
+        std::map<COutPoint, CGoldminenode>::const_iterator mi = mapGoldminenodes.find(lastpaid.second);
+        if (mi == mapGoldminenodes.end() || mi->second.GetLastPaidBlock() != lastpaid.first) {
+            // changed without going through UpdateLastPaid, put everything back in order and start over
+            RebuildPaymentQueue();
+            return GetNextGoldminenodeInQueueForPayment(nBlockHeight, fFilterSigTime, nCountRet, mnInfoRet, fCountAll);
+        }
+        const CGoldminenode& mn = mi->second;
 
-        //check protocol version
-        if(mnpair.second.nProtocolVersion < mnpayments.GetMinGoldminenodePaymentsProto()) continue;
+        if(!mn.IsValidForPayment()) continue;
 
-        //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
-        if(mnpayments.IsScheduled(mnpair.second, nBlockHeight)) continue;
+        //check protocol version
+        if(mn.nProtocolVersion < mnpayments.GetMinGoldminenodePaymentsProto()) continue;
 
         //it's too new, wait for a cycle
-        if(fFilterSigTime && mnpair.second.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
+        if(fFilterSigTime && mn.sigTime + (nMnCount*2.6*60) > GetAdjustedTime()) continue;
 
         //make sure it has at least as many confirmations as there are goldminenodes
-        if(GetUTXOConfirmations(mnpair.first) < nMnCount) continue;
+        if(GetCollateralConfirmations(mn.outpoint) < nMnCount) continue;
 
-        vecGoldminenodeLastPaid.push_back(std::make_pair(mnpair.second.GetLastPaidBlock(), &mnpair.second));
-    }
+        //it's in the list (up to 8 entries ahead of current block to allow propagation) -- so let's skip it
+        if(mnpayments.IsScheduled(mn, nBlockHeight)) continue;
 
-    nCountRet = (int)vecGoldminenodeLastPaid.size();
+        if((int)vecCandidates.size() < nTenthNetwork) {
+            vecCandidates.push_back(&mn);
+        }
+        nCountRet++;
+
+        // with all candidates found the count only matters for the upgrade check below
+        if(!fCountAll && (int)vecCandidates.size() >= nTenthNetwork && (!fFilterSigTime || nCountRet >= nMnCount/3)) break;
+    }
 
     //when the network is in the process of upgrading, don't penalize nodes that recently restarted
     if(fFilterSigTime && nCountRet < nMnCount/3)
-        return GetNextGoldminenodeInQueueForPayment(nBlockHeight, false, nCountRet, mnInfoRet);
-
-    // Sort them low to high
-    sort(vecGoldminenodeLastPaid.begin(), vecGoldminenodeLastPaid.end(), CompareLastPaidBlock());
+        return GetNextGoldminenodeInQueueForPayment(nBlockHeight, false, nCountRet, mnInfoRet, fCountAll);
 
     uint256 blockHash;
     if(!GetBlockHash(blockHash, nBlockHeight - 101)) {
         LogPrintf("CGoldminenode::GetNextGoldminenodeInQueueForPayment -- ERROR: GetBlockHash() failed at nBlockHeight %d\n", nBlockHeight - 101);
         return false;
     }
-    // Look at 1/10 of the oldest nodes (by last payment), calculate their scores and pay the best one
-    //  -- This doesn't look at who is being paid in the +8-10 blocks, allowing for double payments very rarely
-    //  -- 1/100 payments should be a double payment on mainnet - (1/(3000/10))*2
-    //  -- (chance per block * chances before IsScheduled will fire)
-    int nTenthNetwork = nMnCount/10;
-    int nCountTenth = 0;
+
     arith_uint256 nHighest = 0;
     const CGoldminenode *pBestGoldminenode = NULL;
-    for (const auto& s : vecGoldminenodeLastPaid) {
-        arith_uint256 nScore = s.second->CalculateScore(blockHash);
+    for (const auto pmn : vecCandidates) {
+        arith_uint256 nScore = pmn->CalculateScore(blockHash);
         if(nScore > nHighest){
             nHighest = nScore;
-            pBestGoldminenode = s.second;
+            pBestGoldminenode = pmn;
         }
-        nCountTenth++;
-        if(nCountTenth >= nTenthNetwork) break;
     }
     if (pBestGoldminenode) {
         mnInfoRet = pBestGoldminenode->GetInfo();
@@ -584,6 +655,31 @@ bool CGoldminenodeMan::GetNextGoldminenodeInQueueForPayment(int nBlockHeight, bo
     return mnInfoRet.fInfoValid;
 }
 
+int CGoldminenodeMan::GetCollateralConfirmations(const COutPoint& outpoint)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs);
+
+    auto it = mapCollateralHeights.find(outpoint);
+    if (it == mapCollateralHeights.end()) {
+        int nHeight = GetUTXOHeight(outpoint);
+        if (nHeight < 0) return -1;
+        it = mapCollateralHeights.emplace(outpoint, nHeight).first;
+    }
+    return chainActive.Tip() ? chainActive.Height() - it->second + 1 : -1;
+}
+
+void CGoldminenodeMan::RebuildPaymentQueue()
+{
+    AssertLockHeld(cs);
+
+    setPaymentQueue.clear();
+    for (const auto& mnpair : mapGoldminenodes) {
+        setPaymentQueue.insert(std::make_pair(mnpair.second.GetLastPaidBlock(), mnpair.first));
+    }
+    fPaymentQueueDirty = false;
+}
+
 goldminenode_info_t CGoldminenodeMan::FindRandomNotInVec(const std::vector<COutPoint> &vecToExclude, int nProtocolVersion)
 {
     LOCK(cs);
@@ -627,9 +723,9 @@ goldminenode_info_t CGoldminenodeMan::FindRandomNotInVec(const std::vector<COutP
     return goldminenode_info_t();
 }
 
-bool CGoldminenodeMan::GetGoldminenodeScores(const uint256& nBlockHash, CGoldminenodeMan::score_pair_vec_t& vecGoldminenodeScoresRet, int nMinProtocol)
+bool CGoldminenodeMan::GetGoldminenodeScores(const uint256& nBlockHash, CGoldminenodeMan::rank_cache_entry_ptr& pScoresRet, int nMinProtocol)
 {
-    vecGoldminenodeScoresRet.clear();
+    pScoresRet.reset();
 
     if (!goldminenodeSync.IsGoldminenodeListSynced())
         return false;
@@ -639,15 +735,28 @@ bool CGoldminenodeMan::GetGoldminenodeScores(const uint256& nBlockHash, CGoldmin
     if (mapGoldminenodes.empty())
         return false;
 
+    std::pair<uint256, int> key = std::make_pair(nBlockHash, nMinProtocol);
+    if (mapRankCache.Get(key, pScoresRet))
+        return !pScoresRet->vecScores.empty();
+
     // calculate scores
+    std::shared_ptr<rank_cache_entry_t> pScores = std::make_shared<rank_cache_entry_t>();
     for (const auto& mnpair : mapGoldminenodes) {
         if (mnpair.second.nProtocolVersion >= nMinProtocol) {
-            vecGoldminenodeScoresRet.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), &mnpair.second));
+            pScores->vecScores.push_back(std::make_pair(mnpair.second.CalculateScore(nBlockHash), &mnpair.second));
         }
     }
 
-    sort(vecGoldminenodeScoresRet.rbegin(), vecGoldminenodeScoresRet.rend(), CompareScoreMN());
-    return !vecGoldminenodeScoresRet.empty();
+    sort(pScores->vecScores.rbegin(), pScores->vecScores.rend(), CompareScoreMN());
+
+    int nRank = 0;
+    for (const auto& scorePair : pScores->vecScores) {
+        pScores->mapRanks.emplace(scorePair.second->outpoint, ++nRank);
+    }
+
+    mapRankCache.Insert(key, pScores);
+    pScoresRet = pScores;
+    return !pScores->vecScores.empty();
 }
 
 bool CGoldminenodeMan::GetGoldminenodeRank(const COutPoint& outpoint, int& nRankRet, int nBlockHeight, int nMinProtocol)
@@ -666,23 +775,19 @@ bool CGoldminenodeMan::GetGoldminenodeRank(const COutPoint& outpoint, int& nRank
 
     LOCK(cs);
 
-    score_pair_vec_t vecGoldminenodeScores;
-    if (!GetGoldminenodeScores(nBlockHash, vecGoldminenodeScores, nMinProtocol))
+    rank_cache_entry_ptr pScores;
+    if (!GetGoldminenodeScores(nBlockHash, pScores, nMinProtocol))
         return false;
 
-    int nRank = 0;
-    for (const auto& scorePair : vecGoldminenodeScores) {
-        nRank++;
-        if(scorePair.second->outpoint == outpoint) {
-            nRankRet = nRank;
-            return true;
-        }
-    }
+    const auto it = pScores->mapRanks.find(outpoint);
+    if (it == pScores->mapRanks.end())
+        return false;
 
-    return false;
+    nRankRet = it->second;
+    return true;
 }
 
-bool CGoldminenodeMan::GetGoldminenodeRanks(CGoldminenodeMan::rank_pair_vec_t& vecGoldminenodeRanksRet, int nBlockHeight, int nMinProtocol)
+bool CGoldminenodeMan::GetGoldminenodeRanks(CGoldminenodeMan::rank_pair_vec_t& vecGoldminenodeRanksRet, int nBlockHeight, int nMinProtocol, int nMaxRank)
 {
     vecGoldminenodeRanksRet.clear();
 
@@ -698,12 +803,13 @@ bool CGoldminenodeMan::GetGoldminenodeRanks(CGoldminenodeMan::rank_pair_vec_t& v
 
     LOCK(cs);
 
-    score_pair_vec_t vecGoldminenodeScores;
-    if (!GetGoldminenodeScores(nBlockHash, vecGoldminenodeScores, nMinProtocol))
+    rank_cache_entry_ptr pScores;
+    if (!GetGoldminenodeScores(nBlockHash, pScores, nMinProtocol))
         return false;
 
     int nRank = 0;
-    for (const auto& scorePair : vecGoldminenodeScores) {
+    for (const auto& scorePair : pScores->vecScores) {
+        if (nMaxRank > 0 && nRank >= nMaxRank) break;
         nRank++;
         vecGoldminenodeRanksRet.push_back(std::make_pair(nRank, *scorePair.second));
     }
@@ -826,6 +932,8 @@ void CGoldminenodeMan::ProcessMessage(CNode* pfrom, const std::string& strComman
         if(fGoldminenodesAdded) {
             NotifyGoldminenodeUpdates(connman);
         }
+
+        goldminenodeSync.CheckAssetCompleted(connman);
     } else if (strCommand == NetMsgType::MNPING) { //Goldminenode Ping
 
         CGoldminenodePing mnp;
@@ -842,8 +950,11 @@ void CGoldminenodeMan::ProcessMessage(CNode* pfrom, const std::string& strComman
         // Need LOCK2 here to ensure consistent locking order because the CheckAndUpdate call below locks cs_main
         LOCK2(cs_main, cs);
 
-        if(mapSeenGoldminenodePing.count(nHash)) return; //seen
-        mapSeenGoldminenodePing.insert(std::make_pair(nHash, mnp));
+        {
+            LOCK(cs_mapSeenMessages);
+            if(mapSeenGoldminenodePing.count(nHash)) return; //seen
+            mapSeenGoldminenodePing.insert(std::make_pair(nHash, mnp));
+        }
 
         LogPrint("goldminenode", "MNPING -- Goldminenode ping, goldminenode=%s new\n", mnp.goldminenodeOutpoint.ToStringShort());
 
@@ -895,6 +1006,21 @@ void CGoldminenodeMan::ProcessMessage(CNode* pfrom, const std::string& strComman
             SyncSingle(pfrom, goldminenodeOutpoint, connman);
         }
 
+    } else if (strCommand == NetMsgType::GETMNLIST) { // Get the whole Goldminenode list in one message
+        // Same as dseg, ignore such requests until we are fully synced.
+        if (!goldminenodeSync.IsSynced()) return;
+
+        SyncListSnapshot(pfrom, connman);
+
+    } else if (strCommand == NetMsgType::MNLIST) { // Goldminenode list snapshot
+
+        CGoldminenodeListSnapshot snapshot;
+        vRecv >> snapshot;
+
+        if(!goldminenodeSync.IsBlockchainSynced()) return;
+
+        ProcessListSnapshot(pfrom, snapshot, connman);
+
     } else if (strCommand == NetMsgType::MNVERIFY) { // Goldminenode Verify
 
         // Need LOCK2 here to ensure consistent locking order because all functions below call GetBlockHash which locks cs_main
@@ -976,6 +1102,160 @@ void CGoldminenodeMan::SyncAll(CNode* pnode, CConnman& connman)
     LogPrintf("CGoldminenodeMan::%s -- Sent %d Goldminenode invs to peer=%d\n", __func__, nInvCount, pnode->id);
 }
 
+void CGoldminenodeMan::SyncListSnapshot(CNode* pnode, CConnman& connman)
+{
+    // do not provide any data until our node is synced
+    if (!goldminenodeSync.IsSynced()) return;
+
+    bool isLocal = (pnode->addr.IsRFC1918() || pnode->addr.IsLocal());
+
+    CService addrSquashed = Params().AllowMultiplePorts() ? (CService)pnode->addr : CService(pnode->addr, 0);
+
+    CGoldminenodeListSnapshot snapshot;
+
+    {
+        LOCK(cs);
+
+        // a snapshot is as heavy as a full dseg, should only be sent once
+        if(!isLocal && Params().NetworkIDString() == CBaseChainParams::MAIN) {
+            auto it = mAskedUsForListSnapshot.find(addrSquashed);
+            if (it != mAskedUsForListSnapshot.end() && it->second > GetTime()) {
+                LogPrintf("CGoldminenodeMan::%s -- peer already asked me for a list snapshot, peer=%d\n", __func__, pnode->id);
+                return;
+            }
+            mAskedUsForListSnapshot[addrSquashed] = GetTime() + DSEG_UPDATE_SECONDS;
+        }
+
+        snapshot.nHeight = nCachedBlockHeight;
+        snapshot.vecBroadcasts.reserve(mapGoldminenodes.size());
+        for (const auto& mnpair : mapGoldminenodes) {
+            if (mnpair.second.addr.IsRFC1918() || mnpair.second.addr.IsLocal()) continue; // do not send local network goldminenode
+            // NOTE: send goldminenode regardless of its current state, the other node will need it to verify old votes.
+            snapshot.vecBroadcasts.push_back(CGoldminenodeBroadcast(mnpair.second));
+        }
+    }
+
+    snapshot.hashCommitment = snapshot.CalcCommitment();
+
+    // the peer will fall back to dseg if the list doesn't fit into one message
+    if (GetSerializeSize(snapshot, SER_NETWORK, pnode->GetSendVersion()) > MAX_PROTOCOL_MESSAGE_LENGTH) {
+        LogPrintf("CGoldminenodeMan::%s -- list of %d goldminenodes is too large for a snapshot, peer=%d\n", __func__, snapshot.vecBroadcasts.size(), pnode->id);
+        return;
+    }
+
+    connman.PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::MNLIST, snapshot));
+    LogPrintf("CGoldminenodeMan::%s -- Sent snapshot of %d Goldminenodes to peer=%d\n", __func__, snapshot.vecBroadcasts.size(), pnode->id);
+}
+
+void CGoldminenodeMan::ProcessListSnapshot(CNode* pfrom, const CGoldminenodeListSnapshot& snapshot, CConnman& connman)
+{
+    CService addrSquashed = Params().AllowMultiplePorts() ? (CService)pfrom->addr : CService(pfrom->addr, 0);
+
+    {
+        LOCK(cs);
+        auto it = mWeAskedForListSnapshot.find(addrSquashed);
+        if (it == mWeAskedForListSnapshot.end() || it->second < GetTime()) {
+            LogPrint("goldminenode", "CGoldminenodeMan::%s -- unrequested or late snapshot, peer=%d\n", __func__, pfrom->id);
+            return;
+        }
+        mWeAskedForListSnapshot.erase(it);
+    }
+
+    // snapshots only bootstrap the list, later updates come as usual
+    if (goldminenodeSync.IsGoldminenodeListSynced()) return;
+
+    if (snapshot.nVersion != CGoldminenodeListSnapshot::CURRENT_VERSION) {
+        LogPrintf("CGoldminenodeMan::%s -- unknown snapshot version %d, peer=%d\n", __func__, snapshot.nVersion, pfrom->id);
+        return;
+    }
+
+    if (snapshot.hashCommitment != snapshot.CalcCommitment()) {
+        LogPrintf("CGoldminenodeMan::%s -- snapshot commitment mismatch, peer=%d\n", __func__, pfrom->id);
+        LOCK(cs_main);
+        Misbehaving(pfrom->GetId(), 20);
+        return;
+    }
+
+    const std::vector<CGoldminenodeBroadcast>& vecBroadcasts = snapshot.vecBroadcasts;
+
+    // Check all signatures at once on the signature workers. The results
+    // end up in the message signature cache, so the regular checks done
+    // while applying the entries below don't have to repeat them.
+    std::vector<char> vfValid(vecBroadcasts.size(), 0);
+    CMessageSignatureBatch batch(messageSignatureQueue);
+    for (size_t i = 0; i < vecBroadcasts.size(); i++) {
+        const CGoldminenodeBroadcast* pmnb = &vecBroadcasts[i];
+        char* pfValid = &vfValid[i];
+        batch.Push(
+            [pmnb]() {
+                int nDos = 0;
+                return pmnb->CheckSignature(nDos) &&
+                        (pmnb->lastPing == CGoldminenodePing() || pmnb->lastPing.CheckSignature(pmnb->pubKeyGoldminenode, nDos));
+            },
+            [pfValid](bool fValid) {
+                *pfValid = fValid;
+            },
+            pfrom->GetId());
+    }
+    batch.Wait();
+
+    size_t nInvalid = std::count(vfValid.begin(), vfValid.end(), 0);
+    if (nInvalid > 0) {
+        // could be signatures our sporks don't accept yet, let dseg sort it out entry by entry
+        LogPrintf("CGoldminenodeMan::%s -- %d of %d snapshot entries have invalid signatures, ignoring snapshot from peer=%d\n",
+                    __func__, nInvalid, vecBroadcasts.size(), pfrom->id);
+        return;
+    }
+
+    int nAccepted = 0;
+    std::vector<CService> vecAddresses;
+    // The sync stage only moves on after the last chunk, until then the list
+    // is just as incomplete as during a regular sync by dseg.
+    for (size_t nBegin = 0; nBegin < vecBroadcasts.size(); nBegin += LIST_SNAPSHOT_APPLY_ENTRIES) {
+        size_t nEnd = std::min(nBegin + LIST_SNAPSHOT_APPLY_ENTRIES, vecBroadcasts.size());
+        LOCK2(cs_main, cs);
+        for (size_t i = nBegin; i < nEnd; i++) {
+            int nDos = 0;
+            if (CheckMnbAndUpdateGoldminenodeList(pfrom, vecBroadcasts[i], nDos, connman)) {
+                vecAddresses.push_back(vecBroadcasts[i].addr);
+                nAccepted++;
+            }
+        }
+    }
+
+    LogPrintf("CGoldminenodeMan::%s -- applied snapshot at height %d from peer=%d, %d of %d Goldminenodes accepted\n",
+                __func__, snapshot.nHeight, pfrom->id, nAccepted, vecBroadcasts.size());
+
+    // use announced Goldminenodes as peers
+    for (const auto& addr : vecAddresses) {
+        connman.AddNewAddress(CAddress(addr, NODE_NETWORK), pfrom->addr, 2*60*60);
+    }
+
+    if(fGoldminenodesAdded) {
+        NotifyGoldminenodeUpdates(connman);
+    }
+
+    // counts as this peer's announcement, the list came from a fully synced peer
+    if (nAccepted > 0) {
+        goldminenodeSync.AnnounceAssetCount(GOLDMINENODE_SYNC_LIST, nAccepted, pfrom->id);
+        goldminenodeSync.CheckAssetCompleted(connman);
+    }
+}
+
+void CGoldminenodeMan::RequestListSnapshot(CNode* pnode, CConnman& connman)
+{
+    CService addrSquashed = Params().AllowMultiplePorts() ? (CService)pnode->addr : CService(pnode->addr, 0);
+
+    {
+        LOCK(cs);
+        mWeAskedForListSnapshot[addrSquashed] = GetTime() + LIST_SNAPSHOT_WAIT_SECONDS;
+    }
+
+    connman.PushMessage(pnode, CNetMsgMaker(pnode->GetSendVersion()).Make(NetMsgType::GETMNLIST));
+
+    LogPrint("goldminenode", "CGoldminenodeMan::RequestListSnapshot -- asked %s for a list snapshot\n", pnode->addr.ToString());
+}
+
 void CGoldminenodeMan::PushDsegInvs(CNode* pnode, const CGoldminenode& mn)
 {
     AssertLockHeld(cs);
@@ -986,7 +1266,9 @@ void CGoldminenodeMan::PushDsegInvs(CNode* pnode, const CGoldminenode& mn)
     uint256 hashMNP = mnp.GetHash();
     pnode->PushInventory(CInv(MSG_GOLDMINENODE_ANNOUNCE, hashMNB));
     pnode->PushInventory(CInv(MSG_GOLDMINENODE_PING, hashMNP));
-    mapSeenGoldminenodeBroadcast.insert(std::make_pair(hashMNB, std::make_pair(GetTime(), mnb)));
+    LOCK(cs_mapSeenMessages);
+    if (mapSeenGoldminenodeBroadcast.insert(std::make_pair(hashMNB, std::make_pair(GetTime(), mnb))).second)
+        flatdbSeenGoldminenodeBroadcast.SetDirty(hashMNB);
     mapSeenGoldminenodePing.insert(std::make_pair(hashMNP, mnp));
 }
 
@@ -1336,7 +1618,10 @@ void CGoldminenodeMan::ProcessVerifyReply(CNode* pnode, CGoldminenodeVerificatio
                     }
 
                     mWeAskedForVerification[pnode->addr] = mnv;
-                    mapSeenGoldminenodeVerification.insert(std::make_pair(mnv.GetHash(), mnv));
+                    {
+                        LOCK(cs_mapSeenMessages);
+                        mapSeenGoldminenodeVerification.insert(std::make_pair(mnv.GetHash(), mnv));
+                    }
                     mnv.Relay();
 
                 } else {
@@ -1372,11 +1657,14 @@ void CGoldminenodeMan::ProcessVerifyBroadcast(CNode* pnode, const CGoldminenodeV
 
     std::string strError;
 
-    if(mapSeenGoldminenodeVerification.find(mnv.GetHash()) != mapSeenGoldminenodeVerification.end()) {
-        // we already have one
-        return;
+    {
+        LOCK(cs_mapSeenMessages);
+        if(mapSeenGoldminenodeVerification.find(mnv.GetHash()) != mapSeenGoldminenodeVerification.end()) {
+            // we already have one
+            return;
+        }
+        mapSeenGoldminenodeVerification[mnv.GetHash()] = mnv;
     }
-    mapSeenGoldminenodeVerification[mnv.GetHash()] = mnv;
 
     // we don't care about history
     if(mnv.nBlockHeight < nCachedBlockHeight - MAX_POSE_BLOCKS) {
@@ -1487,6 +1775,16 @@ void CGoldminenodeMan::ProcessVerifyBroadcast(CNode* pnode, const CGoldminenodeV
     }
 }
 
+std::shared_ptr<const std::map<COutPoint, CGoldminenode> > CGoldminenodeMan::GetFullGoldminenodeMap()
+{
+    LOCK(cs);
+    if (!pListSnapshot || GetTime() - nListSnapshotTime >= LIST_SNAPSHOT_SECONDS) {
+        pListSnapshot = std::make_shared<const std::map<COutPoint, CGoldminenode> >(mapGoldminenodes);
+        nListSnapshotTime = GetTime();
+    }
+    return pListSnapshot;
+}
+
 std::string CGoldminenodeMan::ToString() const
 {
     std::ostringstream info;
@@ -1511,38 +1809,43 @@ bool CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList(CNode* pfrom, CGoldmine
         LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- goldminenode=%s\n", mnb.outpoint.ToStringShort());
 
         uint256 hash = mnb.GetHash();
-        if(mapSeenGoldminenodeBroadcast.count(hash) && !mnb.fRecovery) { //seen
-            LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- goldminenode=%s seen\n", mnb.outpoint.ToStringShort());
-            // less then 2 pings left before this MN goes into non-recoverable state, bump sync timeout
-            if(GetTime() - mapSeenGoldminenodeBroadcast[hash].first > GOLDMINENODE_NEW_START_REQUIRED_SECONDS - GOLDMINENODE_MIN_MNP_SECONDS * 2) {
-                LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- goldminenode=%s seen update\n", mnb.outpoint.ToStringShort());
-                mapSeenGoldminenodeBroadcast[hash].first = GetTime();
-                goldminenodeSync.BumpAssetLastTime("CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList - seen");
-            }
-            // did we ask this node for it?
-            if(pfrom && IsMnbRecoveryRequested(hash) && GetTime() < mMnbRecoveryRequests[hash].first) {
-                LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- mnb=%s seen request\n", hash.ToString());
-                if(mMnbRecoveryRequests[hash].second.count(pfrom->addr)) {
-                    LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- mnb=%s seen request, addr=%s\n", hash.ToString(), pfrom->addr.ToString());
-                    // do not allow node to send same mnb multiple times in recovery mode
-                    mMnbRecoveryRequests[hash].second.erase(pfrom->addr);
-                    // does it have newer lastPing?
-                    if(mnb.lastPing.sigTime > mapSeenGoldminenodeBroadcast[hash].second.lastPing.sigTime) {
-                        // simulate Check
-                        CGoldminenode mnTemp = CGoldminenode(mnb);
-                        mnTemp.Check();
-                        LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- mnb=%s seen request, addr=%s, better lastPing: %d min ago, projected mn state: %s\n", hash.ToString(), pfrom->addr.ToString(), (GetAdjustedTime() - mnb.lastPing.sigTime)/60, mnTemp.GetStateString());
-                        if(mnTemp.IsValidStateForAutoStart(mnTemp.nActiveState)) {
-                            // this node thinks it's a good one
-                            LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- goldminenode=%s seen good\n", mnb.outpoint.ToStringShort());
-                            mMnbRecoveryGoodReplies[hash].push_back(mnb);
+        {
+            LOCK(cs_mapSeenMessages);
+            if(mapSeenGoldminenodeBroadcast.count(hash) && !mnb.fRecovery) { //seen
+                LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- goldminenode=%s seen\n", mnb.outpoint.ToStringShort());
+                // less then 2 pings left before this MN goes into non-recoverable state, bump sync timeout
+                if(GetTime() - mapSeenGoldminenodeBroadcast[hash].first > GOLDMINENODE_NEW_START_REQUIRED_SECONDS - GOLDMINENODE_MIN_MNP_SECONDS * 2) {
+                    LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- goldminenode=%s seen update\n", mnb.outpoint.ToStringShort());
+                    mapSeenGoldminenodeBroadcast[hash].first = GetTime();
+                    flatdbSeenGoldminenodeBroadcast.SetDirty(hash);
+                    goldminenodeSync.BumpAssetLastTime("CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList - seen");
+                }
+                // did we ask this node for it?
+                if(pfrom && IsMnbRecoveryRequested(hash) && GetTime() < mMnbRecoveryRequests[hash].first) {
+                    LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- mnb=%s seen request\n", hash.ToString());
+                    if(mMnbRecoveryRequests[hash].second.count(pfrom->addr)) {
+                        LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- mnb=%s seen request, addr=%s\n", hash.ToString(), pfrom->addr.ToString());
+                        // do not allow node to send same mnb multiple times in recovery mode
+                        mMnbRecoveryRequests[hash].second.erase(pfrom->addr);
+                        // does it have newer lastPing?
+                        if(mnb.lastPing.sigTime > mapSeenGoldminenodeBroadcast[hash].second.lastPing.sigTime) {
+                            // simulate Check
+                            CGoldminenode mnTemp = CGoldminenode(mnb);
+                            mnTemp.Check();
+                            LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- mnb=%s seen request, addr=%s, better lastPing: %d min ago, projected mn state: %s\n", hash.ToString(), pfrom->addr.ToString(), (GetAdjustedTime() - mnb.lastPing.sigTime)/60, mnTemp.GetStateString());
+                            if(mnTemp.IsValidStateForAutoStart(mnTemp.nActiveState)) {
+                                // this node thinks it's a good one
+                                LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- goldminenode=%s seen good\n", mnb.outpoint.ToStringShort());
+                                mMnbRecoveryGoodReplies[hash].push_back(mnb);
+                            }
                         }
                     }
                 }
+                return true;
             }
-            return true;
+            mapSeenGoldminenodeBroadcast.insert(std::make_pair(hash, std::make_pair(GetTime(), mnb)));
+            flatdbSeenGoldminenodeBroadcast.SetDirty(hash);
         }
-        mapSeenGoldminenodeBroadcast.insert(std::make_pair(hash, std::make_pair(GetTime(), mnb)));
 
         LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- goldminenode=%s new\n", mnb.outpoint.ToStringShort());
 
@@ -1554,13 +1857,25 @@ bool CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList(CNode* pfrom, CGoldmine
         // search Goldminenode list
         CGoldminenode* pmn = Find(mnb.outpoint);
         if(pmn) {
-            CGoldminenodeBroadcast mnbOld = mapSeenGoldminenodeBroadcast[CGoldminenodeBroadcast(*pmn).GetHash()].second;
+            CGoldminenodeBroadcast mnbOld;
+            {
+                LOCK(cs_mapSeenMessages);
+                uint256 hashOld = CGoldminenodeBroadcast(*pmn).GetHash();
+                mnbOld = mapSeenGoldminenodeBroadcast[hashOld].second;
+                // the lookup inserts an empty entry when the broadcast was never seen
+                flatdbSeenGoldminenodeBroadcast.SetDirty(hashOld);
+            }
             if(!mnb.Update(pmn, nDos, connman)) {
                 LogPrint("goldminenode", "CGoldminenodeMan::CheckMnbAndUpdateGoldminenodeList -- Update() failed, goldminenode=%s\n", mnb.outpoint.ToStringShort());
                 return false;
             }
+            // protocol version could have changed
+            InvalidateListCaches();
             if(hash != mnbOld.GetHash()) {
+                LOCK(cs_mapSeenMessages);
                 mapSeenGoldminenodeBroadcast.erase(mnbOld.GetHash());
+                flatdbSeenGoldminenodeBroadcast.SetDirty(mnbOld.GetHash());
+                ForgetRelayPayload(CInv(MSG_GOLDMINENODE_ANNOUNCE, mnbOld.GetHash()));
             }
             return true;
         }
@@ -1608,7 +1923,16 @@ void CGoldminenodeMan::UpdateLastPaid(const CBlockIndex* pindex)
                             nCachedBlockHeight, nLastRunBlockHeight, nMaxBlocksToScanBack);
 
     for (auto& mnpair : mapGoldminenodes) {
+        int nLastPaidOld = mnpair.second.GetLastPaidBlock();
         mnpair.second.UpdateLastPaid(pindex, nMaxBlocksToScanBack);
+        int nLastPaid = mnpair.second.GetLastPaidBlock();
+        if (nLastPaid == nLastPaidOld || fPaymentQueueDirty) continue;
+        // move the entry to its new place, an entry that isn't where we expect it means the queue is out of date
+        if (setPaymentQueue.erase(std::make_pair(nLastPaidOld, mnpair.first)) == 0) {
+            fPaymentQueueDirty = true;
+            continue;
+        }
+        setPaymentQueue.insert(std::make_pair(nLastPaid, mnpair.first));
     }
 
     nLastRunBlockHeight = nCachedBlockHeight;
@@ -1656,12 +1980,41 @@ void CGoldminenodeMan::SetGoldminenodeLastPing(const COutPoint& outpoint, const
     if(mnp.fSentinelIsCurrent) {
         UpdateLastSentinelPingTime();
     }
+    LOCK(cs_mapSeenMessages);
     mapSeenGoldminenodePing.insert(std::make_pair(mnp.GetHash(), mnp));
 
     CGoldminenodeBroadcast mnb(*pmn);
     uint256 hash = mnb.GetHash();
     if(mapSeenGoldminenodeBroadcast.count(hash)) {
         mapSeenGoldminenodeBroadcast[hash].second.lastPing = mnp;
+        flatdbSeenGoldminenodeBroadcast.SetDirty(hash);
+        ForgetRelayPayload(CInv(MSG_GOLDMINENODE_ANNOUNCE, hash));
+    }
+}
+
+void CGoldminenodeMan::DisconnectedBlocks(const CBlockIndex* pindexFork)
+{
+    LOCK(cs);
+
+    // a collateral of a disconnected block may be mined again at another height, or not at all
+    for (auto it = mapCollateralHeights.begin(); it != mapCollateralHeights.end(); ) {
+        if (it->second > pindexFork->nHeight) {
+            mapCollateralHeights.erase(it++);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void CGoldminenodeMan::SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock)
+{
+    if (tx.IsCoinBase() || posInBlock == CMainSignals::SYNC_TRANSACTION_NOT_IN_BLOCK) return;
+
+    LOCK(cs);
+
+    // a spent collateral doesn't count towards the payment queue anymore
+    for (const auto& txin : tx.vin) {
+        mapCollateralHeights.erase(txin.prevout);
     }
 }
 
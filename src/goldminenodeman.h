@@ -5,14 +5,57 @@
 #ifndef GOLDMINENODEMAN_H
 #define GOLDMINENODEMAN_H
 
+#include "cachemap.h"
+#include "flat-database.h"
 #include "goldminenode.h"
 #include "sync.h"
 
+#include <memory>
+#include <set>
+
 class CGoldminenodeMan;
 class CConnman;
 
 extern CGoldminenodeMan mnodeman;
 
+/**
+ * The whole goldminenode list in one message, lets a fresh node get the list
+ * from a single peer instead of an inv and a getdata for every broadcast and ping.
+ */
+class CGoldminenodeListSnapshot
+{
+public:
+    static const uint8_t CURRENT_VERSION = 1;
+
+    uint8_t nVersion;
+    /// Height of the sender's chain when the snapshot was taken
+    int nHeight;
+    /// Broadcasts carrying the latest known ping of each goldminenode
+    std::vector<CGoldminenodeBroadcast> vecBroadcasts;
+    /// Unkeyed hash set by the sender, it only detects corruption. Entries are trusted because of their signatures.
+    uint256 hashCommitment;
+
+    CGoldminenodeListSnapshot() :
+        nVersion(CURRENT_VERSION),
+        nHeight(0),
+        vecBroadcasts(),
+        hashCommitment()
+        {}
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(nVersion);
+        READWRITE(nHeight);
+        READWRITE(vecBroadcasts);
+        READWRITE(hashCommitment);
+    }
+
+    /// Hash of all entries including signatures and pings, the same whatever format the message used
+    uint256 CalcCommitment() const;
+};
+
 class CGoldminenodeMan
 {
 public:
@@ -21,10 +64,20 @@ public:
     typedef std::pair<int, const CGoldminenode> rank_pair_t;
     typedef std::vector<rank_pair_t> rank_pair_vec_t;
 
+    /// Goldminenode scores for one block hash sorted by rank, plus a rank lookup by outpoint
+    struct rank_cache_entry_t {
+        score_pair_vec_t vecScores;
+        std::map<COutPoint, int> mapRanks;
+    };
+    typedef std::shared_ptr<const rank_cache_entry_t> rank_cache_entry_ptr;
+
 private:
     static const std::string SERIALIZATION_VERSION_STRING;
 
     static const int DSEG_UPDATE_SECONDS        = 3 * 60 * 60;
+    static const int LIST_SNAPSHOT_WAIT_SECONDS = 60;
+    // snapshot entries applied per cs_main/cs lock, so block processing isn't held up by a big list
+    static const size_t LIST_SNAPSHOT_APPLY_ENTRIES = 100;
 
     static const int LAST_PAID_SCAN_BLOCKS;
 
@@ -39,6 +92,10 @@ private:
     static const int MNB_RECOVERY_WAIT_SECONDS      = 60;
     static const int MNB_RECOVERY_RETRY_SECONDS     = 3 * 60 * 60;
 
+    static const int MAX_RANK_CACHE_SIZE            = 32;
+
+    static const int LIST_SNAPSHOT_SECONDS          = 1;
+
 
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
@@ -54,6 +111,10 @@ private:
     std::map<CService, int64_t> mWeAskedForGoldminenodeList;
     // which Goldminenodes we've asked for
     std::map<COutPoint, std::map<CService, int64_t> > mWeAskedForGoldminenodeListEntry;
+    // who's asked us for a list snapshot and when they may ask again
+    std::map<CService, int64_t> mAskedUsForListSnapshot;
+    // who we asked for a list snapshot and until when we accept the reply
+    std::map<CService, int64_t> mWeAskedForListSnapshot;
 
     // who we asked for the goldminenode verification
     std::map<CService, CGoldminenodeVerification> mWeAskedForVerification;
@@ -66,6 +127,22 @@ private:
     std::map<CService, std::pair<int64_t, CGoldminenodeVerification> > mapPendingMNV;
     CCriticalSection cs_mapPendingMNV;
 
+    // sorted scores per (block hash, min protocol), computed once per block and
+    // cleared whenever mapGoldminenodes changes since entries point into it
+    CacheMap<std::pair<uint256, int>, rank_cache_entry_ptr> mapRankCache;
+
+    // (last paid block, outpoint) of all goldminenodes, oldest payment first.
+    // Rebuilt lazily after the list changes, UpdateLastPaid moves single entries.
+    std::set<std::pair<int, COutPoint> > setPaymentQueue;
+    bool fPaymentQueueDirty;
+    // collateral heights, saves a pcoinsTip lookup per entry when selecting the next payee
+    std::map<COutPoint, int> mapCollateralHeights;
+
+    // immutable copy of mapGoldminenodes handed out to RPC and UI readers,
+    // republished on list changes or when older than LIST_SNAPSHOT_SECONDS
+    std::shared_ptr<const std::map<COutPoint, CGoldminenode> > pListSnapshot;
+    int64_t nListSnapshotTime;
+
     /// Set when goldminenodes are added, cleared when CGovernanceManager is notified
     bool fGoldminenodesAdded;
 
@@ -79,16 +156,32 @@ private:
     /// Find an entry
     CGoldminenode* Find(const COutPoint& outpoint);
 
-    bool GetGoldminenodeScores(const uint256& nBlockHash, score_pair_vec_t& vecGoldminenodeScoresRet, int nMinProtocol = 0);
+    bool GetGoldminenodeScores(const uint256& nBlockHash, rank_cache_entry_ptr& pScoresRet, int nMinProtocol = 0);
 
     void SyncSingle(CNode* pnode, const COutPoint& outpoint, CConnman& connman);
     void SyncAll(CNode* pnode, CConnman& connman);
+    void SyncListSnapshot(CNode* pnode, CConnman& connman);
+    void ProcessListSnapshot(CNode* pfrom, const CGoldminenodeListSnapshot& snapshot, CConnman& connman);
 
     void PushDsegInvs(CNode* pnode, const CGoldminenode& mn);
 
+    /// Drop everything derived from mapGoldminenodes, must be called whenever it changes
+    void InvalidateListCaches() { mapRankCache.Clear(); fPaymentQueueDirty = true; pListSnapshot.reset(); }
+
+    /// Confirmations of a goldminenode collateral using the cached collateral height, -1 if unknown or spent
+    int GetCollateralConfirmations(const COutPoint& outpoint);
+
+    void RebuildPaymentQueue();
+
 public:
+    // critical section to protect the seen message maps below, can be taken
+    // without cs so that relay and getdata don't wait for list maintenance;
+    // when both are needed cs must be locked first
+    mutable CCriticalSection cs_mapSeenMessages;
     // Keep track of all broadcasts I've seen
     std::map<uint256, std::pair<int64_t, CGoldminenodeBroadcast> > mapSeenGoldminenodeBroadcast;
+    // On disk copy of the broadcasts above, every change to them must be passed to SetDirty
+    CFlatDBMap<uint256, std::pair<int64_t, CGoldminenodeBroadcast> > flatdbSeenGoldminenodeBroadcast;
     // Keep track of all pings I've seen
     std::map<uint256, CGoldminenodePing> mapSeenGoldminenodePing;
     // Keep track of all verifications I've seen
@@ -101,7 +194,7 @@ public:
 
     template <typename Stream, typename Operation>
     inline void SerializationOp(Stream& s, Operation ser_action) {
-        LOCK(cs);
+        LOCK2(cs, cs_mapSeenMessages);
         std::string strVersion;
         if(ser_action.ForRead()) {
             READWRITE(strVersion);
@@ -120,8 +213,10 @@ public:
         READWRITE(nLastSentinelPingTime);
         READWRITE(nDsqCount);
 
-        READWRITE(mapSeenGoldminenodeBroadcast);
         READWRITE(mapSeenGoldminenodePing);
+        if(ser_action.ForRead()) {
+            InvalidateListCaches();
+        }
         if(ser_action.ForRead() && (strVersion != SERIALIZATION_VERSION_STRING)) {
             Clear();
         }
@@ -151,6 +246,9 @@ public:
     /// Clear Goldminenode vector
     void Clear();
 
+    /// Write the seen broadcasts changed since the last dump to their database
+    bool DumpSeenBroadcasts();
+
     /// Count Goldminenodes filtered by nProtocolVersion.
     /// Goldminenode nProtocolVersion should match or be above the one specified in param here.
     int CountGoldminenodes(int nProtocolVersion = -1);
@@ -162,6 +260,8 @@ public:
     // int CountByIP(int nNetworkType);
 
     void DsegUpdate(CNode* pnode, CConnman& connman);
+    /// Ask a peer for the whole list in one message, peers that don't know the request ignore it
+    void RequestListSnapshot(CNode* pnode, CConnman& connman);
 
     /// Versions of Find that are safe to use from outside the class
     bool Get(const COutPoint& outpoint, CGoldminenode& goldminenodeRet);
@@ -171,17 +271,23 @@ public:
     bool GetGoldminenodeInfo(const CPubKey& pubKeyGoldminenode, goldminenode_info_t& mnInfoRet);
     bool GetGoldminenodeInfo(const CScript& payee, goldminenode_info_t& mnInfoRet);
 
-    /// Find an entry in the goldminenode list that is next to be paid
-    bool GetNextGoldminenodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCountRet, goldminenode_info_t& mnInfoRet);
+    /**
+     * Find an entry in the goldminenode list that is next to be paid. nCountRet is the
+     * number of goldminenodes eligible for payment, unless fCountAll is false: then the
+     * queue is only walked as far as the selection needs and nCountRet may be lower.
+     */
+    bool GetNextGoldminenodeInQueueForPayment(int nBlockHeight, bool fFilterSigTime, int& nCountRet, goldminenode_info_t& mnInfoRet, bool fCountAll = false);
     /// Same as above but use current block height
-    bool GetNextGoldminenodeInQueueForPayment(bool fFilterSigTime, int& nCountRet, goldminenode_info_t& mnInfoRet);
+    bool GetNextGoldminenodeInQueueForPayment(bool fFilterSigTime, int& nCountRet, goldminenode_info_t& mnInfoRet, bool fCountAll = false);
 
     /// Find a random entry
     goldminenode_info_t FindRandomNotInVec(const std::vector<COutPoint> &vecToExclude, int nProtocolVersion = -1);
 
-    std::map<COutPoint, CGoldminenode> GetFullGoldminenodeMap() { return mapGoldminenodes; }
+    /// Get a read-only snapshot of the whole list, shared between callers
+    std::shared_ptr<const std::map<COutPoint, CGoldminenode> > GetFullGoldminenodeMap();
 
-    bool GetGoldminenodeRanks(rank_pair_vec_t& vecGoldminenodeRanksRet, int nBlockHeight = -1, int nMinProtocol = 0);
+    /// Get goldminenodes in rank order, up to nMaxRank of them if it is positive
+    bool GetGoldminenodeRanks(rank_pair_vec_t& vecGoldminenodeRanksRet, int nBlockHeight = -1, int nMinProtocol = 0, int nMaxRank = -1);
     bool GetGoldminenodeRank(const COutPoint &outpoint, int& nRankRet, int nBlockHeight = -1, int nMinProtocol = 0);
 
     void ProcessGoldminenodeConnections(CConnman& connman);
@@ -208,6 +314,10 @@ public:
     bool IsMnbRecoveryRequested(const uint256& hash) { return mMnbRecoveryRequests.count(hash); }
 
     void UpdateLastPaid(const CBlockIndex* pindex);
+    /// Blocks above pindexFork were disconnected, forget the collateral heights cached for them
+    void DisconnectedBlocks(const CBlockIndex* pindexFork);
+    /// Forget the collateral heights cached for outputs spent by a transaction of a connected block
+    void SyncTransaction(const CTransaction& tx, const CBlockIndex* pindex, int posInBlock);
 
     bool IsSentinelPingActive();
     void UpdateLastSentinelPingTime();
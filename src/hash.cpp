@@ -249,3 +249,79 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     SIPROUND;
     return v0 ^ v1 ^ v2 ^ v3;
 }
+
+namespace {
+
+/** Run one X11 stage in place over nLanes 64-byte intermediate hashes. */
+template<typename Context>
+void HashX11Stage(void (*init)(void*), void (*update)(void*, const void*, size_t), void (*close)(void*, void*), uint512* phash, size_t nLanes)
+{
+    Context ctx_init;
+    init(&ctx_init);
+    for (size_t i = 0; i < nLanes; i++) {
+        Context ctx = ctx_init;
+        update(&ctx, &phash[i], 64);
+        close(&ctx, &phash[i]);
+    }
+}
+
+/** Run the ten X11 stages following blake512 over a batch and emit the results. */
+void HashX11FinishLanes(uint512* phash, size_t nLanes, uint256* phashes)
+{
+    HashX11Stage<sph_bmw512_context>(sph_bmw512_init, sph_bmw512, sph_bmw512_close, phash, nLanes);
+    HashX11Stage<sph_groestl512_context>(sph_groestl512_init, sph_groestl512, sph_groestl512_close, phash, nLanes);
+    HashX11Stage<sph_skein512_context>(sph_skein512_init, sph_skein512, sph_skein512_close, phash, nLanes);
+    HashX11Stage<sph_jh512_context>(sph_jh512_init, sph_jh512, sph_jh512_close, phash, nLanes);
+    HashX11Stage<sph_keccak512_context>(sph_keccak512_init, sph_keccak512, sph_keccak512_close, phash, nLanes);
+    HashX11Stage<sph_luffa512_context>(sph_luffa512_init, sph_luffa512, sph_luffa512_close, phash, nLanes);
+    HashX11Stage<sph_cubehash512_context>(sph_cubehash512_init, sph_cubehash512, sph_cubehash512_close, phash, nLanes);
+    HashX11Stage<sph_shavite512_context>(sph_shavite512_init, sph_shavite512, sph_shavite512_close, phash, nLanes);
+    HashX11Stage<sph_simd512_context>(sph_simd512_init, sph_simd512, sph_simd512_close, phash, nLanes);
+    HashX11Stage<sph_echo512_context>(sph_echo512_init, sph_echo512, sph_echo512_close, phash, nLanes);
+
+    for (size_t i = 0; i < nLanes; i++) {
+        phashes[i] = phash[i].trim256();
+    }
+}
+
+} // namespace
+
+void HashX11Headers(const unsigned char* pheaders, size_t nCount, uint256* phashes)
+{
+    sph_blake512_context ctx_init;
+    sph_blake512_init(&ctx_init);
+
+    uint512 hash[X11_BATCH_LANES];
+    while (nCount > 0) {
+        size_t nLanes = std::min(nCount, X11_BATCH_LANES);
+        for (size_t i = 0; i < nLanes; i++) {
+            sph_blake512_context ctx_blake = ctx_init;
+            sph_blake512(&ctx_blake, pheaders + i * 80, 80);
+            sph_blake512_close(&ctx_blake, &hash[i]);
+        }
+        HashX11FinishLanes(hash, nLanes, phashes);
+        pheaders += nLanes * 80;
+        phashes += nLanes;
+        nCount -= nLanes;
+    }
+}
+
+CX11NonceHasher::CX11NonceHasher(const unsigned char* pheader)
+{
+    memcpy(header, pheader, sizeof(header));
+}
+
+void CX11NonceHasher::Hash(uint32_t nNonceStart, size_t nCount, uint256* phashes) const
+{
+    unsigned char headers[80 * X11_BATCH_LANES];
+    while (nCount > 0) {
+        size_t nLanes = std::min(nCount, X11_BATCH_LANES);
+        for (size_t i = 0; i < nLanes; i++) {
+            memcpy(headers + i * 80, header, 76);
+            WriteLE32(headers + i * 80 + 76, nNonceStart++);
+        }
+        HashX11Headers(headers, nLanes, phashes);
+        phashes += nLanes;
+        nCount -= nLanes;
+    }
+}
@@ -378,4 +378,32 @@ inline uint256 HashX11(const T1 pbegin, const T1 pend)
     return hash[10].trim256();
 }
 
+/** Number of headers the batched X11 hashers below process per pass. */
+static const size_t X11_BATCH_LANES = 8;
+
+/** Compute the X11 hashes of nCount consecutive serialized 80-byte block
+ *  headers. Headers are processed X11_BATCH_LANES at a time, running each
+ *  stage over the whole batch before moving on to the next one. This is the
+ *  same scalar code as HashX11 and is no faster per header.
+ */
+void HashX11Headers(const unsigned char* pheaders, size_t nCount, uint256* phashes);
+
+/** X11 hasher for scanning the nonce of a single 80-byte block header,
+ *  X11_BATCH_LANES nonces at a time through HashX11Headers.
+ *  There is no blake512 midstate of the fixed header bytes to reuse:
+ *  blake512 buffers its input until a 128-byte block is full, so the whole
+ *  80-byte header is compressed in one go when the hash is closed.
+ */
+class CX11NonceHasher
+{
+private:
+    unsigned char header[80];
+
+public:
+    /** pheader points to a serialized 80-byte header; its nonce is ignored. */
+    explicit CX11NonceHasher(const unsigned char* pheader);
+    /** Hash nCount consecutive nonces starting at nNonceStart into phashes. */
+    void Hash(uint32_t nNonceStart, size_t nCount, uint256* phashes) const;
+};
+
 #endif // BITCOIN_HASH_H
@@ -0,0 +1,238 @@
+// Copyright (c) 2017-2022 The Advanced Technology Coin
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "indexbuilder.h"
+
+#include "chain.h"
+#include "chainparams.h"
+#include "init.h"
+#include "txdb.h"
+#include "undo.h"
+#include "util.h"
+#include "utiltime.h"
+#include "validation.h"
+
+#include <thread>
+
+#include <boost/thread.hpp>
+
+namespace {
+
+/** A block and its undo data, read from disk by one of the parallel readers */
+struct CIndexBuildBlock
+{
+    CDiskBlockPos pos;
+    CDiskBlockPos posUndo;
+    uint256 hashPrev;
+    CBlock block;
+    CBlockUndo blockundo;
+    bool fRead;
+
+    CIndexBuildBlock() : fRead(false) {}
+};
+
+void ReadIndexBuildBlocks(std::vector<CIndexBuildBlock>& vBlocks, size_t nBegin, size_t nEnd, bool fUndo)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    for (size_t i = nBegin; i < nEnd; i++) {
+        CIndexBuildBlock& entry = vBlocks[i];
+        entry.fRead = ReadBlockFromDisk(entry.block, entry.pos, consensusParams) &&
+                      (!fUndo || UndoReadFromDisk(entry.blockundo, entry.posUndo, entry.hashPrev));
+    }
+}
+
+/** Read the prepared blocks in parallel and add their rows */
+bool AddIndexRows(CIndexRows& rows, int nIndexes, const std::vector<const CBlockIndex*>& vIndex, std::vector<CIndexBuildBlock>& vBlocks)
+{
+    const bool fUndo = nIndexes & (INDEX_BUILD_ADDRESS | INDEX_BUILD_SPENT);
+    size_t nThreads = std::max(1, std::min(GetNumCores(), 8));
+    size_t nPerThread = (vBlocks.size() + nThreads - 1) / nThreads;
+    std::vector<std::thread> vThreads;
+    for (size_t nBegin = nPerThread; nBegin < vBlocks.size(); nBegin += nPerThread) {
+        vThreads.push_back(std::thread(ReadIndexBuildBlocks, std::ref(vBlocks), nBegin, std::min(nBegin + nPerThread, vBlocks.size()), fUndo));
+    }
+    ReadIndexBuildBlocks(vBlocks, 0, std::min(nPerThread, vBlocks.size()), fUndo);
+    for (size_t i = 0; i < vThreads.size(); i++) {
+        vThreads[i].join();
+    }
+
+    for (size_t i = 0; i < vBlocks.size(); i++) {
+        if (!vBlocks[i].fRead)
+            return error("%s: failed to read block %s", __func__, vIndex[i]->GetBlockHash().ToString());
+        if (!AddBlockIndexRows(rows, vBlocks[i].block, vBlocks[i].blockundo, vIndex[i],
+                               nIndexes & INDEX_BUILD_ADDRESS, nIndexes & INDEX_BUILD_SPENT, nIndexes & INDEX_BUILD_TIMESTAMP))
+            return false;
+    }
+    return true;
+}
+
+/** Disk positions of the blocks, requires cs_main */
+bool PrepareIndexBuildBlocks(const std::vector<const CBlockIndex*>& vIndex, bool fUndo, std::vector<CIndexBuildBlock>& vBlocks)
+{
+    AssertLockHeld(cs_main);
+    vBlocks.assign(vIndex.size(), CIndexBuildBlock());
+    for (size_t i = 0; i < vIndex.size(); i++) {
+        const CBlockIndex* pindex = vIndex[i];
+        if (!(pindex->nStatus & BLOCK_HAVE_DATA) || (fUndo && !(pindex->nStatus & BLOCK_HAVE_UNDO)))
+            return error("%s: no block or undo data for block %s", __func__, pindex->GetBlockHash().ToString());
+        vBlocks[i].pos = pindex->GetBlockPos();
+        vBlocks[i].posUndo = pindex->GetUndoPos();
+        vBlocks[i].hashPrev = pindex->pprev->GetBlockHash();
+    }
+    return true;
+}
+
+std::string GetIndexNames(int nIndexes)
+{
+    std::string strNames;
+    if (nIndexes & INDEX_BUILD_ADDRESS)
+        strNames += " address";
+    if (nIndexes & INDEX_BUILD_SPENT)
+        strNames += " spent";
+    if (nIndexes & INDEX_BUILD_TIMESTAMP)
+        strNames += " timestamp";
+    return strNames;
+}
+
+} // anon namespace
+
+int GetIndexesToBuild()
+{
+    int nEnabled = (fAddressIndex ? INDEX_BUILD_ADDRESS : 0) |
+                   (fSpentIndex ? INDEX_BUILD_SPENT : 0) |
+                   (fTimestampIndex ? INDEX_BUILD_TIMESTAMP : 0);
+
+    int nIndexes = 0;
+    uint256 hashBlock;
+    if (pblocktree->ReadIndexBuild(nIndexes, hashBlock)) {
+        // a finished build may have been interrupted before it cleaned up
+        nIndexes &= ~nEnabled;
+        if (nIndexes != 0)
+            return nIndexes;
+        pblocktree->EraseIndexBuild();
+    }
+
+    nIndexes = (GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ? INDEX_BUILD_ADDRESS : 0) |
+               (GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ? INDEX_BUILD_SPENT : 0) |
+               (GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX) ? INDEX_BUILD_TIMESTAMP : 0);
+    return nIndexes & ~nEnabled;
+}
+
+void ThreadBuildIndexes(int nIndexes)
+{
+    RenameThread("arc-indexbuild");
+
+    // -reindex and -loadblock connect the blocks themselves
+    while (fImporting || fReindex) {
+        MilliSleep(1000);
+    }
+
+    if (fPruneMode || fHavePruned) {
+        LogPrintf("%s: can't build%s index on pruned block files, rebuild the database using -reindex\n", __func__, GetIndexNames(nIndexes));
+        return;
+    }
+
+    const bool fUndo = nIndexes & (INDEX_BUILD_ADDRESS | INDEX_BUILD_SPENT);
+    const CBlockIndex* pindexLast = NULL;
+    {
+        LOCK(cs_main);
+        int nBuildIndexes;
+        uint256 hashBuild;
+        if (pblocktree->ReadIndexBuild(nBuildIndexes, hashBuild)) {
+            BlockMap::iterator mi = mapBlockIndex.find(hashBuild);
+            if (mi == mapBlockIndex.end() || !chainActive.Contains(mi->second)) {
+                LogPrintf("%s: last indexed block %s is not in the active chain, rebuild the database using -reindex\n", __func__, hashBuild.ToString());
+                return;
+            }
+            pindexLast = mi->second;
+        } else if (!fAddressIndex && !fSpentIndex && !fTimestampIndex) {
+            // the first indexes, they go where -indexdb says
+            pblocktree->WriteFlag("indexdb", GetBoolArg("-indexdb", DEFAULT_INDEXDB), true);
+        }
+    }
+    LogPrintf("%s: building%s index from height %d\n", __func__, GetIndexNames(nIndexes), pindexLast ? pindexLast->nHeight + 1 : 1);
+
+    CIndexRows rows;
+    std::vector<const CBlockIndex*> vIndex;
+    std::vector<CIndexBuildBlock> vBlocks;
+    int64_t nStart = GetTimeMillis();
+    while (true) {
+        boost::this_thread::interruption_point();
+        if (ShutdownRequested())
+            return;
+
+        vIndex.clear();
+        {
+            LOCK(cs_main);
+            if (pindexLast && !chainActive.Contains(pindexLast)) {
+                LogPrintf("%s: block %s was disconnected while it was indexed, rebuild the database using -reindex\n", __func__, pindexLast->GetBlockHash().ToString());
+                return;
+            }
+            // the genesis block is never connected, it has no index rows
+            int nHeight = pindexLast ? pindexLast->nHeight + 1 : 1;
+            int nEnd = std::min(nHeight + INDEX_BUILD_READ_BLOCKS, chainActive.Height() - INDEX_BUILD_TIP_DISTANCE);
+            if (nHeight >= nEnd)
+                break;
+            for (; nHeight < nEnd; nHeight++) {
+                vIndex.push_back(chainActive[nHeight]);
+            }
+            if (!PrepareIndexBuildBlocks(vIndex, fUndo, vBlocks))
+                return;
+        }
+
+        // the blocks stay on disk and in mapBlockIndex even if they are disconnected meanwhile
+        if (!AddIndexRows(rows, nIndexes, vIndex, vBlocks))
+            return;
+        pindexLast = vIndex.back();
+
+        if (rows.Count() >= INDEX_BUILD_MAX_ROWS) {
+            if (!pblocktree->WriteIndexRows(rows, nIndexes, pindexLast->GetBlockHash())) {
+                LogPrintf("%s: failed to write index rows\n", __func__);
+                return;
+            }
+            rows.Clear();
+            LogPrintf("%s: indexed up to height %d (%.2fs)\n", __func__, pindexLast->nHeight, 0.001 * (GetTimeMillis() - nStart));
+        }
+    }
+
+    // catch up with the tip while no block can be connected and turn the indexes on
+    LOCK(cs_main);
+    if (pindexLast && !chainActive.Contains(pindexLast)) {
+        LogPrintf("%s: block %s was disconnected while it was indexed, rebuild the database using -reindex\n", __func__, pindexLast->GetBlockHash().ToString());
+        return;
+    }
+    vIndex.clear();
+    for (int nHeight = pindexLast ? pindexLast->nHeight + 1 : 1; nHeight <= chainActive.Height(); nHeight++) {
+        vIndex.push_back(chainActive[nHeight]);
+    }
+    if (!PrepareIndexBuildBlocks(vIndex, fUndo, vBlocks) || !AddIndexRows(rows, nIndexes, vIndex, vBlocks))
+        return;
+    if (!vIndex.empty())
+        pindexLast = vIndex.back();
+    if (!pblocktree->WriteIndexRows(rows, nIndexes, pindexLast ? pindexLast->GetBlockHash() : uint256())) {
+        LogPrintf("%s: failed to write index rows\n", __func__);
+        return;
+    }
+    // blocks replayed after a crash must not be indexed a second time
+    FlushStateToDisk();
+
+    // The flags live in the block tree, the build state possibly in the index database.
+    // They must be on disk before the build state is gone, or the next start would build
+    // the indexes again on top of the existing rows.
+    if (nIndexes & INDEX_BUILD_ADDRESS) {
+        fAddressIndex = true;
+        pblocktree->WriteFlag("addressindex", true, true);
+        pblocktree->WriteFlag("addressbalance", true, true);
+    }
+    if (nIndexes & INDEX_BUILD_SPENT) {
+        fSpentIndex = true;
+        pblocktree->WriteFlag("spentindex", true, true);
+    }
+    if (nIndexes & INDEX_BUILD_TIMESTAMP) {
+        fTimestampIndex = true;
+        pblocktree->WriteFlag("timestampindex", true, true);
+    }
+    pblocktree->EraseIndexBuild();
+    LogPrintf("%s: built%s index up to height %d in %.2fs\n", __func__, GetIndexNames(nIndexes), chainActive.Height(), 0.001 * (GetTimeMillis() - nStart));
+}
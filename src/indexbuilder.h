@@ -0,0 +1,38 @@
+// Copyright (c) 2017-2022 The Advanced Technology Coin
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef INDEXBUILDER_H
+#define INDEXBUILDER_H
+
+#include <stddef.h>
+
+/** Indexes the background builder can add to an existing chain */
+enum {
+    INDEX_BUILD_ADDRESS     = (1 << 0),
+    INDEX_BUILD_SPENT       = (1 << 1),
+    INDEX_BUILD_TIMESTAMP   = (1 << 2),
+};
+
+//! Blocks read ahead by the parallel readers
+static const int INDEX_BUILD_READ_BLOCKS = 256;
+//! Rows collected in memory before they are written out in one batch
+static const size_t INDEX_BUILD_MAX_ROWS = 2000000;
+//! The builder stays this far behind the tip until it catches up under cs_main
+static const int INDEX_BUILD_TIP_DISTANCE = 100;
+
+/**
+ * Indexes that were requested but are not in the database yet. An unfinished
+ * build takes precedence, the remaining indexes are built after it.
+ * Call after the block index is loaded.
+ */
+int GetIndexesToBuild();
+
+/**
+ * Build the given INDEX_BUILD_* indexes from the block and undo files while
+ * the node keeps running. Once the builder caught up with the tip the index
+ * flags are set and ConnectBlock maintains the indexes from then on.
+ */
+void ThreadBuildIndexes(int nIndexes);
+
+#endif // INDEXBUILDER_H
@@ -11,6 +11,7 @@
 #include "goldminenodeman.h"
 #include "messagesigner.h"
 #include "net.h"
+#include "net_processing.h"
 #include "netmessagemaker.h"
 #include "protocol.h"
 #include "spork.h"
@@ -82,7 +83,25 @@ void CInstantSend::ProcessMessage(CNode* pfrom, const std::string& strCommand, C
             if (!ret.second) return;
         }
 
-        ProcessNewTxLockVote(pfrom, vote, connman);
+        if(!vote.IsValid(pfrom, connman, false)) {
+            // could be because of missing MN
+            LogPrint("instantsend", "TXLOCKVOTE -- Vote is invalid, txid=%s\n", vote.GetTxHash().ToString());
+            return;
+        }
+
+        // the signature is checked by the signature workers during vote bursts
+        messageSignatureQueue.Push(
+            [vote]() {
+                return vote.CheckSignature();
+            },
+            [this, vote, &connman](bool fValid) {
+                if(!fValid) {
+                    LogPrintf("TXLOCKVOTE -- Signature invalid, txid=%s\n", vote.GetTxHash().ToString());
+                    return;
+                }
+                ProcessNewTxLockVote(NULL, vote, connman, true);
+            },
+            pfrom->GetId());
 
         return;
     }
@@ -312,12 +331,12 @@ void CInstantSend::Vote(CTxLockCandidate& txLockCandidate, CConnman& connman)
     }
 }
 
-bool CInstantSend::ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, CConnman& connman)
+bool CInstantSend::ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, CConnman& connman, bool fValidated)
 {
     uint256 txHash = vote.GetTxHash();
     uint256 nVoteHash = vote.GetHash();
 
-    if(!vote.IsValid(pfrom, connman)) {
+    if(!fValidated && !vote.IsValid(pfrom, connman)) {
         // could be because of missing MN
         LogPrint("instantsend", "CInstantSend::%s -- Vote is invalid, txid=%s\n", __func__, txHash.ToString());
         return false;
@@ -692,6 +711,7 @@ void CInstantSend::CheckAndRemove()
         if(itVote->second.IsExpired(nCachedBlockHeight)) {
             LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing expired vote: txid=%s  goldminenode=%s\n",
                     itVote->second.GetTxHash().ToString(), itVote->second.GetGoldminenodeOutpoint().ToStringShort());
+            ForgetRelayPayload(CInv(MSG_TXLOCK_VOTE, itVote->first));
             mapTxLockVotes.erase(itVote++);
         } else {
             ++itVote;
@@ -704,6 +724,7 @@ void CInstantSend::CheckAndRemove()
         if(itOrphanVote->second.IsTimedOut()) {
             LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing timed out orphan vote: txid=%s  goldminenode=%s\n",
                     itOrphanVote->second.GetTxHash().ToString(), itOrphanVote->second.GetGoldminenodeOutpoint().ToStringShort());
+            ForgetRelayPayload(CInv(MSG_TXLOCK_VOTE, itOrphanVote->first));
             mapTxLockVotes.erase(itOrphanVote->first);
             mapTxLockVotesOrphan.erase(itOrphanVote++);
         } else {
@@ -717,6 +738,7 @@ void CInstantSend::CheckAndRemove()
         if(itVote->second.IsFailed()) {
             LogPrint("instantsend", "CInstantSend::CheckAndRemove -- Removing vote for failed lock attempt: txid=%s  goldminenode=%s\n",
                     itVote->second.GetTxHash().ToString(), itVote->second.GetGoldminenodeOutpoint().ToStringShort());
+            ForgetRelayPayload(CInv(MSG_TXLOCK_VOTE, itVote->first));
             mapTxLockVotes.erase(itVote++);
         } else {
             ++itVote;
@@ -1008,7 +1030,7 @@ int CTxLockRequest::GetMaxSignatures() const
 // CTxLockVote
 //
 
-bool CTxLockVote::IsValid(CNode* pnode, CConnman& connman) const
+bool CTxLockVote::IsValid(CNode* pnode, CConnman& connman, bool fCheckSignature) const
 {
     if(!mnodeman.Has(outpointGoldminenode)) {
         LogPrint("instantsend", "CTxLockVote::IsValid -- Unknown goldminenode %s\n", outpointGoldminenode.ToStringShort());
@@ -1040,7 +1062,7 @@ bool CTxLockVote::IsValid(CNode* pnode, CConnman& connman) const
         return false;
     }
 
-    if(!CheckSignature()) {
+    if(fCheckSignature && !CheckSignature()) {
         LogPrintf("CTxLockVote::IsValid -- Signature invalid\n");
         return false;
     }
@@ -74,9 +74,6 @@ private:
     void CreateEmptyTxLockCandidate(const uint256& txHash);
     void Vote(CTxLockCandidate& txLockCandidate, CConnman& connman);
 
-    /// Process consensus vote message
-    bool ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, CConnman& connman);
-
     void UpdateVotedOutpoints(const CTxLockVote& vote, CTxLockCandidate& txLockCandidate);
     bool ProcessOrphanTxLockVote(const CTxLockVote& vote);
     void ProcessOrphanTxLockVotes();
@@ -90,6 +87,9 @@ private:
 
     bool IsInstantSendReadyToLock(const uint256 &txHash);
 
+    /// Process consensus vote message, fValidated skips the vote's IsValid() check
+    bool ProcessNewTxLockVote(CNode* pfrom, const CTxLockVote& vote, CConnman& connman, bool fValidated = false);
+
 public:
     CCriticalSection cs_instantsend;
 
@@ -238,7 +238,7 @@ public:
     COutPoint GetOutpoint() const { return outpoint; }
     COutPoint GetGoldminenodeOutpoint() const { return outpointGoldminenode; }
 
-    bool IsValid(CNode* pnode, CConnman& connman) const;
+    bool IsValid(CNode* pnode, CConnman& connman, bool fCheckSignature = true) const;
     void SetConfirmedHeight(int nConfirmedHeightIn) { nConfirmedHeight = nConfirmedHeightIn; }
     bool IsExpired(int nHeight) const;
     bool IsTimedOut() const;
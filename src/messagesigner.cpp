@@ -3,12 +3,110 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "base58.h"
+#include "crypto/sha256.h"
+#include "cuckoocache.h"
 #include "hash.h"
+#include "random.h"
 #include "validation.h" // For strMessageMagic
 #include "messagesigner.h"
 #include "tinyformat.h"
+#include "util.h"
 #include "utilstrencodings.h"
 
+#include <atomic>
+
+#include <boost/thread/locks.hpp>
+#include <boost/thread/shared_mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+CMessageSignatureQueue messageSignatureQueue(16);
+
+namespace {
+
+/** Entries are nonced SHA256 hashes already, so just slice them like SignatureCacheHasher does */
+class MessageSignatureCacheHasher
+{
+public:
+    template <uint8_t hash_select>
+    uint32_t operator()(const uint256& key) const
+    {
+        static_assert(hash_select < 8, "MessageSignatureCacheHasher only has 8 hashes available.");
+        uint32_t u;
+        std::memcpy(&u, key.begin() + 4 * hash_select, 4);
+        return u;
+    }
+};
+
+class CMessageSignatureCache
+{
+private:
+    //! Entries are SHA256(nonce || hash || key id || signature)
+    uint256 nonce;
+    CuckooCache::cache<uint256, MessageSignatureCacheHasher> setValid;
+    boost::shared_mutex cs_msgsigcache;
+    uint32_t nElements;
+
+public:
+    std::atomic<uint64_t> nHits;
+    std::atomic<uint64_t> nMisses;
+
+    CMessageSignatureCache() : nElements(0), nHits(0), nMisses(0)
+    {
+        GetRandBytes(nonce.begin(), 32);
+        // usable before InitMessageSignatureCache(), e.g. in benchmarks
+        nElements = setValid.setup_bytes(0);
+    }
+
+    void ComputeEntry(uint256& entry, const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig)
+    {
+        CSHA256().Write(nonce.begin(), 32).Write(hash.begin(), 32).Write(keyID.begin(), keyID.size()).Write(vchSig.data(), vchSig.size()).Finalize(entry.begin());
+    }
+
+    bool Get(const uint256& entry)
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_msgsigcache);
+        return setValid.contains(entry, false);
+    }
+
+    void Set(const uint256& entry)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_msgsigcache);
+        setValid.insert(entry);
+    }
+
+    uint32_t Setup(size_t nBytes)
+    {
+        boost::unique_lock<boost::shared_mutex> lock(cs_msgsigcache);
+        nElements = setValid.setup_bytes(nBytes);
+        return nElements;
+    }
+
+    uint32_t GetElements()
+    {
+        boost::shared_lock<boost::shared_mutex> lock(cs_msgsigcache);
+        return nElements;
+    }
+};
+
+CMessageSignatureCache messageSignatureCache;
+
+} // anon namespace
+
+void InitMessageSignatureCache()
+{
+    size_t nMaxCacheSize = std::min(std::max((int64_t)0, GetArg("-maxmsgsigcachesize", DEFAULT_MAX_MSG_SIG_CACHE_SIZE)), (int64_t)1024) * ((size_t) 1 << 20);
+    size_t nElems = messageSignatureCache.Setup(nMaxCacheSize);
+    LogPrintf("Using %zu MiB out of %zu requested for message signature cache, able to store %zu elements\n",
+            (nElems*sizeof(uint256)) >> 20, nMaxCacheSize >> 20, nElems);
+}
+
+void GetMessageSignatureCacheStats(uint64_t& nHitsRet, uint64_t& nMissesRet, uint32_t& nElementsRet)
+{
+    nHitsRet = messageSignatureCache.nHits;
+    nMissesRet = messageSignatureCache.nMisses;
+    nElementsRet = messageSignatureCache.GetElements();
+}
+
 bool CMessageSigner::GetKeysFromSecret(const std::string& strSecret, CKey& keyRet, CPubKey& pubkeyRet)
 {
     CBitcoinSecret vchSecret;
@@ -56,6 +154,14 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CPubKey& pubkey, const s
 
 bool CHashSigner::VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, std::string& strErrorRet)
 {
+    uint256 entry;
+    messageSignatureCache.ComputeEntry(entry, hash, keyID, vchSig);
+    if(messageSignatureCache.Get(entry)) {
+        ++messageSignatureCache.nHits;
+        return true;
+    }
+    ++messageSignatureCache.nMisses;
+
     CPubKey pubkeyFromSig;
     if(!pubkeyFromSig.RecoverCompact(hash, vchSig)) {
         strErrorRet = "Error recovering public key.";
@@ -69,5 +175,154 @@ bool CHashSigner::VerifyHash(const uint256& hash, const CKeyID& keyID, const std
         return false;
     }
 
+    // only valid signatures are cached, invalid ones are cheap to send and would just evict good entries
+    messageSignatureCache.Set(entry);
     return true;
 }
+
+void CMessageSignatureQueue::Push(const check_t& check, const completion_t& completion, NodeId nPeer)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        if (nWorkers > 0) {
+            std::shared_ptr<CCheck> pcheck = std::make_shared<CCheck>(check, completion, nPeer);
+            queue.push_back(pcheck);
+            mapPeerChecks[nPeer].push_back(pcheck);
+            condWorker.notify_one();
+            return;
+        }
+    }
+    completion(check());
+}
+
+void CMessageSignatureQueue::Complete(const std::shared_ptr<CCheck>& pcheck, bool fValid)
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    pcheck->fDone = true;
+    pcheck->fValid = fValid;
+
+    // whoever runs the peer's completions picks this one up when it's due
+    if (setPeersCompleting.count(pcheck->nPeer))
+        return;
+    setPeersCompleting.insert(pcheck->nPeer);
+
+    std::deque<std::shared_ptr<CCheck> >& vPeerChecks = mapPeerChecks[pcheck->nPeer];
+    while (!vPeerChecks.empty() && vPeerChecks.front()->fDone) {
+        std::shared_ptr<CCheck> pfront = vPeerChecks.front();
+        vPeerChecks.pop_front();
+        lock.unlock();
+        if (pfront->completion) {
+            try {
+                pfront->completion(pfront->fValid);
+            } catch (const std::exception& e) {
+                PrintExceptionContinue(&e, "CMessageSignatureQueue::Complete()");
+            }
+        }
+        lock.lock();
+    }
+    if (vPeerChecks.empty())
+        mapPeerChecks.erase(pcheck->nPeer);
+    setPeersCompleting.erase(pcheck->nPeer);
+}
+
+void CMessageSignatureQueue::RunChecks(const std::vector<std::shared_ptr<CCheck> >& vChecks)
+{
+    for (const auto& pcheck : vChecks) {
+        bool fValid = false;
+        try {
+            fValid = pcheck->check();
+        } catch (const std::exception& e) {
+            PrintExceptionContinue(&e, "CMessageSignatureQueue::RunChecks()");
+            // the check didn't finish, neither should the message
+            pcheck->completion = nullptr;
+        }
+        Complete(pcheck, fValid);
+    }
+}
+
+void CMessageSignatureQueue::Thread()
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nWorkers++;
+    }
+
+    std::vector<std::shared_ptr<CCheck> > vChecks;
+    vChecks.reserve(nBatchSize);
+    while (true) {
+        {
+            boost::unique_lock<boost::mutex> lock(mutex);
+            while (queue.empty()) {
+                try {
+                    condWorker.wait(lock); // interruption point
+                } catch (const boost::thread_interrupted&) {
+                    // the wait returned with the lock held, a Push() from now on sees this worker gone
+                    if (--nWorkers == 0) {
+                        // nobody is left to run what was queued before, and its completions
+                        // release peers and wake up batches
+                        vChecks.assign(queue.begin(), queue.end());
+                        queue.clear();
+                    }
+                    lock.unlock();
+                    boost::this_thread::disable_interruption di;
+                    RunChecks(vChecks);
+                    throw;
+                }
+            }
+            // take a fair share of the queue, like CCheckQueue does
+            unsigned int nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nWorkers + 1)));
+            for (unsigned int i = 0; i < nNow; i++) {
+                vChecks.push_back(queue.front());
+                queue.pop_front();
+            }
+        }
+        RunChecks(vChecks);
+        vChecks.clear();
+    }
+}
+
+void CMessageSignatureBatch::Push(const CMessageSignatureQueue::check_t& check, const CMessageSignatureQueue::completion_t& completion, NodeId nPeer)
+{
+    {
+        boost::unique_lock<boost::mutex> lock(mutex);
+        nTodo++;
+    }
+    // the completion must run whatever happens, or Wait() would never return
+    queue.Push([check]() {
+        try {
+            return check();
+        } catch (const std::exception& e) {
+            PrintExceptionContinue(&e, "CMessageSignatureBatch::Push()");
+            return false;
+        }
+    }, [this, completion](bool fValid) {
+        try {
+            completion(fValid);
+        } catch (...) {
+            Done();
+            throw;
+        }
+        Done();
+    }, nPeer);
+}
+
+void CMessageSignatureBatch::Done()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    if (--nTodo == 0)
+        condDone.notify_all();
+}
+
+void CMessageSignatureBatch::Wait()
+{
+    boost::unique_lock<boost::mutex> lock(mutex);
+    while (nTodo > 0) {
+        condDone.wait(lock);
+    }
+}
+
+void ThreadMessageSignatureCheck()
+{
+    RenameThread("arc-msgsigch");
+    messageSignatureQueue.Thread();
+}
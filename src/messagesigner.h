@@ -6,6 +6,21 @@
 #define MESSAGESIGNER_H
 
 #include "key.h"
+#include "net.h"
+
+#include <stdint.h>
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+//! Default size of the cache of valid goldminenode message signatures, in MiB
+static const unsigned int DEFAULT_MAX_MSG_SIG_CACHE_SIZE = 4;
 
 /** Helper class for signing messages and checking their signatures
  */
@@ -35,4 +50,110 @@ public:
     static bool VerifyHash(const uint256& hash, const CKeyID& keyID, const std::vector<unsigned char>& vchSig, std::string& strErrorRet);
 };
 
+/**
+ * Valid signatures seen by CHashSigner::VerifyHash (and therefore by all of
+ * CMessageSigner) are remembered by (key id, hash, signature), so the same
+ * ping, vote or queue relayed by several peers is only recovered once.
+ */
+void InitMessageSignatureCache();
+void GetMessageSignatureCacheStats(uint64_t& nHitsRet, uint64_t& nMissesRet, uint32_t& nElementsRet);
+
+/**
+ * Queue for goldminenode message signature checks.
+ *
+ * Message handlers push the signature check of a message together with the
+ * rest of its handling (the completion). Worker threads run the check and
+ * then call the completion with the result, so bursts of votes are verified
+ * in parallel instead of one after another on the message handler thread.
+ * Completions run on the worker threads and must do their own locking.
+ * The completions of one peer's checks run one at a time, in the order the
+ * checks were pushed, just like the messages would be handled inline.
+ * Without any workers checks and completions run inline in Push().
+ */
+class CMessageSignatureQueue
+{
+public:
+    typedef std::function<bool()> check_t;
+    typedef std::function<void(bool)> completion_t;
+
+private:
+    struct CCheck
+    {
+        check_t check;
+        completion_t completion;
+        NodeId nPeer;
+        bool fDone;
+        bool fValid;
+
+        CCheck(const check_t& checkIn, const completion_t& completionIn, NodeId nPeerIn) :
+            check(checkIn), completion(completionIn), nPeer(nPeerIn), fDone(false), fValid(false) {}
+    };
+
+    //! Mutex to protect the inner state
+    boost::mutex mutex;
+
+    //! Worker threads block on this when out of work
+    boost::condition_variable condWorker;
+
+    //! Checks to be performed, oldest first
+    std::deque<std::shared_ptr<CCheck> > queue;
+
+    //! Checks of each peer whose completion didn't run yet, in the order they were pushed
+    std::map<NodeId, std::deque<std::shared_ptr<CCheck> > > mapPeerChecks;
+
+    //! Peers whose completions are being run by one of the workers
+    std::set<NodeId> setPeersCompleting;
+
+    //! Number of running worker threads
+    int nWorkers;
+
+    //! The maximum number of checks a worker takes at once
+    unsigned int nBatchSize;
+
+    //! Record the result of a finished check and run the completions of its peer that are due
+    void Complete(const std::shared_ptr<CCheck>& pcheck, bool fValid);
+
+    //! Run checks taken off the queue and complete them
+    void RunChecks(const std::vector<std::shared_ptr<CCheck> >& vChecks);
+
+public:
+    CMessageSignatureQueue(unsigned int nBatchSizeIn) : nWorkers(0), nBatchSize(nBatchSizeIn) {}
+
+    //! Queue a check of a message from nPeer, its completion is called with the result once it's done
+    void Push(const check_t& check, const completion_t& completion, NodeId nPeer);
+
+    //! Worker thread
+    void Thread();
+};
+
+/**
+ * A set of checks pushed to a CMessageSignatureQueue that can be waited for
+ * on its own, while the queue keeps serving checks of other messages.
+ */
+class CMessageSignatureBatch
+{
+private:
+    CMessageSignatureQueue& queue;
+    boost::mutex mutex;
+    boost::condition_variable condDone;
+    //! Number of checks of this batch whose completion didn't run yet
+    unsigned int nTodo;
+
+    void Done();
+
+public:
+    CMessageSignatureBatch(CMessageSignatureQueue& queueIn) : queue(queueIn), nTodo(0) {}
+
+    //! Queue a check as part of this batch, a check that throws counts as failed
+    void Push(const CMessageSignatureQueue::check_t& check, const CMessageSignatureQueue::completion_t& completion, NodeId nPeer);
+
+    //! Wait until all checks of this batch have completed
+    void Wait();
+};
+
+extern CMessageSignatureQueue messageSignatureQueue;
+
+/** Run a message signature check worker thread */
+void ThreadMessageSignatureCheck();
+
 #endif
@@ -35,6 +35,10 @@
 #include <fcntl.h>
 #endif
 
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -51,6 +55,10 @@
 // We add a random period time (0 to 1 seconds) to feeler connections to prevent synchronization.
 #define FEELER_SLEEP_WINDOW 1
 
+// Max time the socket handler waits for socket events before doing housekeeping,
+// sends and receives wake it up earlier
+#define SOCKET_EVENTS_TIMEOUT_MS 50
+
 #if !defined(HAVE_MSG_NOSIGNAL) && !defined(MSG_NOSIGNAL)
 #define MSG_NOSIGNAL 0
 #endif
@@ -884,6 +892,7 @@ size_t CConnman::SocketSendData(CNode *pnode) const
         assert(pnode->nSendSize == 0);
     }
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
+    pnode->fHasPendingSend = !pnode->vSendMsg.empty();
     return nSentSize;
 }
 
@@ -1122,9 +1131,289 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
     }
 }
 
+// Implement the following logic:
+// * If there is data to send, wait for the socket to become writable. As this only
+//   happens when optimistic write failed, we choose to first drain the
+//   write buffer in this case before receiving more. This avoids
+//   needlessly queueing received data, if the remote peer is not themselves
+//   receiving data. This means properly utilizing TCP flow control signalling.
+// * Otherwise, if there is space left in the receive buffer, wait for
+//   receiving data.
+// * Hand off all complete messages to the processor, to be handled without
+//   blocking here.
+static void GetSocketInterest(CNode* pnode, bool& select_recv, bool& select_send)
+{
+    select_recv = !pnode->fPauseRecv;
+    select_send = pnode->fHasPendingSend;
+}
+
+void CConnman::InitSocketEvents()
+{
+#ifndef WIN32
+    if (wakeupPipe[0] == -1) {
+        if (pipe(wakeupPipe) == 0) {
+            for (int i = 0; i < 2; i++) {
+                int flags = fcntl(wakeupPipe[i], F_GETFL, 0);
+                fcntl(wakeupPipe[i], F_SETFL, flags | O_NONBLOCK);
+            }
+        } else {
+            LogPrintf("%s: pipe() failed, socket handler can't be woken up early\n", __func__);
+            wakeupPipe[0] = wakeupPipe[1] = -1;
+        }
+    }
+#endif
+    fWakeupPending = false;
+
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollfd == -1) {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            LogPrintf("%s: epoll_create1() failed, falling back to select(): %s\n", __func__, NetworkErrorString(errno));
+            return;
+        }
+
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        for (ListenSocket& hListenSocket : vhListenSocket) {
+            if (hListenSocket.socket == INVALID_SOCKET)
+                continue;
+            event.data.ptr = &hListenSocket;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hListenSocket.socket, &event) != 0) {
+                LogPrintf("%s: epoll_ctl() failed, falling back to select(): %s\n", __func__, NetworkErrorString(errno));
+                close(epollfd);
+                epollfd = -1;
+                return;
+            }
+        }
+        if (wakeupPipe[0] != -1) {
+            event.data.ptr = wakeupPipe;
+            epoll_ctl(epollfd, EPOLL_CTL_ADD, wakeupPipe[0], &event);
+        }
+    }
+#endif
+    LogPrintf("Using %s for socket events\n", epollfd != -1 ? "epoll" : "select");
+}
+
+void CConnman::CloseSocketEvents()
+{
+#ifdef HAVE_SYS_EPOLL_H
+    if (epollfd != -1) {
+        close(epollfd);
+        epollfd = -1;
+    }
+#endif
+#ifndef WIN32
+    for (int i = 0; i < 2; i++) {
+        int fd = wakeupPipe[i];
+        wakeupPipe[i] = -1;
+        if (fd != -1)
+            close(fd);
+    }
+#endif
+}
+
+void CConnman::WakeSelect()
+{
+#ifndef WIN32
+    int fd = wakeupPipe[1];
+    if (fd == -1 || fWakeupPending.exchange(true))
+        return;
+
+    char buf = 0;
+    if (write(fd, &buf, sizeof(buf)) != 1) {
+        LogPrint("net", "%s: write() to wakeup pipe failed\n", __func__);
+    }
+#endif
+}
+
+void CConnman::SocketEvents(std::set<CNode*>& recv_set, std::set<CNode*>& send_set, std::set<CNode*>& error_set, std::set<SOCKET>& listen_set)
+{
+    if (epollfd != -1)
+        SocketEventsEpoll(recv_set, send_set, error_set, listen_set);
+    else
+        SocketEventsSelect(recv_set, send_set, error_set, listen_set);
+
+#ifndef WIN32
+    // clear the flag before draining so that a wakeup racing with us isn't lost
+    if (wakeupPipe[0] != -1 && fWakeupPending.exchange(false)) {
+        char buf[128];
+        while (read(wakeupPipe[0], buf, sizeof(buf)) > 0) {}
+    }
+#endif
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+void CConnman::SocketEventsEpoll(std::set<CNode*>& recv_set, std::set<CNode*>& send_set, std::set<CNode*>& error_set, std::set<SOCKET>& listen_set)
+{
+    // Sockets stay registered, only nodes whose interest changed since the
+    // last round cost an epoll_ctl() call. The kernel then only reports the
+    // sockets that are actually ready, instead of us scanning all of them.
+    size_t nSockets = vhListenSocket.size() + 1;
+    {
+        LOCK(cs_vNodes);
+        nSockets += vNodes.size();
+        BOOST_FOREACH(CNode* pnode, vNodes)
+        {
+            bool select_recv, select_send;
+            GetSocketInterest(pnode, select_recv, select_send);
+
+            uint32_t nEvents = select_send ? (uint32_t)EPOLLOUT : (select_recv ? (uint32_t)EPOLLIN : 0);
+            if (pnode->fSocketEventsAdded && pnode->nSocketEvents == nEvents)
+                continue;
+
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+
+            struct epoll_event event = {};
+            event.events = nEvents;
+            event.data.ptr = pnode;
+            int op = pnode->fSocketEventsAdded ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+            if (epoll_ctl(epollfd, op, pnode->hSocket, &event) != 0) {
+                LogPrintf("%s: epoll_ctl() failed for peer=%d: %s\n", __func__, pnode->id, NetworkErrorString(errno));
+                pnode->fDisconnect = true;
+                continue;
+            }
+            pnode->fSocketEventsAdded = true;
+            pnode->nSocketEvents = nEvents;
+        }
+    }
+
+    std::vector<struct epoll_event> vEvents(nSockets);
+    int nEvents = epoll_wait(epollfd, vEvents.data(), vEvents.size(), SOCKET_EVENTS_TIMEOUT_MS);
+    if (nEvents < 0) {
+        if (errno != EINTR)
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(errno));
+        interruptNet.sleep_for(std::chrono::milliseconds(SOCKET_EVENTS_TIMEOUT_MS));
+        return;
+    }
+
+    for (int i = 0; i < nEvents; i++) {
+        const struct epoll_event& event = vEvents[i];
+        if (event.data.ptr == wakeupPipe)
+            continue;
+
+        bool fListen = false;
+        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+            if (event.data.ptr == &hListenSocket) {
+                listen_set.insert(hListenSocket.socket);
+                fListen = true;
+                break;
+            }
+        }
+        if (fListen)
+            continue;
+
+        // stays valid until ThreadSocketHandler deletes disconnected nodes in its next round
+        CNode* pnode = static_cast<CNode*>(event.data.ptr);
+        if (event.events & EPOLLIN)
+            recv_set.insert(pnode);
+        if (event.events & EPOLLOUT)
+            send_set.insert(pnode);
+        if (event.events & (EPOLLERR | EPOLLHUP))
+            error_set.insert(pnode);
+    }
+}
+#endif
+
+void CConnman::SocketEventsSelect(std::set<CNode*>& recv_set, std::set<CNode*>& send_set, std::set<CNode*>& error_set, std::set<SOCKET>& listen_set)
+{
+    struct timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = SOCKET_EVENTS_TIMEOUT_MS * 1000; // frequency to poll pnode->vSend
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+        FD_SET(hListenSocket.socket, &fdsetRecv);
+        hSocketMax = std::max(hSocketMax, hListenSocket.socket);
+        have_fds = true;
+    }
+
+#ifndef WIN32
+    if (wakeupPipe[0] != -1) {
+        FD_SET(wakeupPipe[0], &fdsetRecv);
+        hSocketMax = std::max(hSocketMax, (SOCKET)wakeupPipe[0]);
+        have_fds = true;
+    }
+#endif
+
+    {
+        LOCK(cs_vNodes);
+        BOOST_FOREACH(CNode* pnode, vNodes)
+        {
+            bool select_recv, select_send;
+            GetSocketInterest(pnode, select_recv, select_send);
+
+            LOCK(pnode->cs_hSocket);
+            if (pnode->hSocket == INVALID_SOCKET)
+                continue;
+
+            FD_SET(pnode->hSocket, &fdsetError);
+            hSocketMax = std::max(hSocketMax, pnode->hSocket);
+            have_fds = true;
+
+            if (select_send) {
+                FD_SET(pnode->hSocket, &fdsetSend);
+                continue;
+            }
+            if (select_recv) {
+                FD_SET(pnode->hSocket, &fdsetRecv);
+            }
+        }
+    }
+
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                         &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    if (interruptNet)
+        return;
+
+    if (nSelect == SOCKET_ERROR)
+    {
+        if (have_fds)
+        {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            for (unsigned int i = 0; i <= hSocketMax; i++)
+                FD_SET(i, &fdsetRecv);
+        }
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
+            return;
+    }
+
+    BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
+        if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            listen_set.insert(hListenSocket.socket);
+    }
+
+    LOCK(cs_vNodes);
+    BOOST_FOREACH(CNode* pnode, vNodes)
+    {
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            continue;
+        if (FD_ISSET(pnode->hSocket, &fdsetRecv))
+            recv_set.insert(pnode);
+        if (FD_ISSET(pnode->hSocket, &fdsetSend))
+            send_set.insert(pnode);
+        if (FD_ISSET(pnode->hSocket, &fdsetError))
+            error_set.insert(pnode);
+    }
+}
+
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    int64_t nLastInactivityCheck = 0;
     while (!interruptNet)
     {
         //
@@ -1192,104 +1481,32 @@ void CConnman::ThreadSocketHandler()
                 clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
-        //
-        // Find which sockets have data to receive
-        //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
+        std::set<CNode*> recv_set, send_set, error_set;
+        std::set<SOCKET> listen_set;
+        SocketEvents(recv_set, send_set, error_set, listen_set);
 
-        BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
-
-        {
-            LOCK(cs_vNodes);
-            BOOST_FOREACH(CNode* pnode, vNodes)
-            {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-
-                bool select_recv = !pnode->fPauseRecv;
-                bool select_send;
-                {
-                    LOCK(pnode->cs_vSend);
-                    select_send = !pnode->vSendMsg.empty();
-                }
-
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
-            }
-        }
-
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
         if (interruptNet)
             return;
 
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
-                return;
-        }
-
         //
         // Accept new connections
         //
         BOOST_FOREACH(const ListenSocket& hListenSocket, vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && listen_set.count(hListenSocket.socket))
             {
                 AcceptConnection(hListenSocket);
             }
         }
 
         //
-        // Service each socket
+        // Service the sockets that are ready. Nodes are only deleted by this
+        // thread, at the top of the loop, so the pointers in the sets stay valid.
         //
-        std::vector<CNode*> vNodesCopy = CopyNodeVector();
-        BOOST_FOREACH(CNode* pnode, vNodesCopy)
+        std::set<CNode*> ready_set(recv_set);
+        ready_set.insert(send_set.begin(), send_set.end());
+        ready_set.insert(error_set.begin(), error_set.end());
+        BOOST_FOREACH(CNode* pnode, ready_set)
         {
             if (interruptNet)
                 return;
@@ -1297,17 +1514,9 @@ void CConnman::ThreadSocketHandler()
             //
             // Receive
             //
-            bool recvSet = false;
-            bool sendSet = false;
-            bool errorSet = false;
-            {
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
-            }
+            bool recvSet = recv_set.count(pnode) > 0;
+            bool sendSet = send_set.count(pnode) > 0;
+            bool errorSet = error_set.count(pnode) > 0;
             if (recvSet || errorSet)
             {
                 {
@@ -1377,41 +1586,49 @@ void CConnman::ThreadSocketHandler()
                     RecordBytesSent(nBytes);
                 }
             }
+        }
 
-            //
-            // Inactivity checking
-            //
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pnode->nTimeConnected > 60)
+        //
+        // Inactivity checking, once a second is enough
+        //
+        int64_t nTime = GetSystemTimeInSeconds();
+        if (nTime != nLastInactivityCheck)
+        {
+            nLastInactivityCheck = nTime;
+            std::vector<CNode*> vNodesCopy = CopyNodeVector();
+            BOOST_FOREACH(CNode* pnode, vNodesCopy)
             {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+                if (nTime - pnode->nTimeConnected > 60)
                 {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-                else if (!pnode->fSuccessfullyConnected)
-                {
-                    LogPrintf("version handshake timeout from %d\n", pnode->id);
-                    pnode->fDisconnect = true;
+                    if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+                    {
+                        LogPrint("net", "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->id);
+                        pnode->fDisconnect = true;
+                    }
+                    else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+                    {
+                        LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+                        pnode->fDisconnect = true;
+                    }
+                    else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+                    {
+                        LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+                        pnode->fDisconnect = true;
+                    }
+                    else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+                    {
+                        LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+                        pnode->fDisconnect = true;
+                    }
+                    else if (!pnode->fSuccessfullyConnected)
+                    {
+                        LogPrintf("version handshake timeout from %d\n", pnode->id);
+                        pnode->fDisconnect = true;
+                    }
                 }
             }
+            ReleaseNodeVector(vNodesCopy);
         }
-        ReleaseNodeVector(vNodesCopy);
     }
 }
 
@@ -1419,9 +1636,9 @@ void CConnman::WakeMessageHandler()
 {
     {
         std::lock_guard<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = true;
+        nMsgProcWake++;
     }
-    condMsgProc.notify_one();
+    condMsgProc.notify_all();
 }
 
 
@@ -2017,6 +2234,8 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         LOCK(cs_vNodes);
         vNodes.push_back(pnode);
     }
+    // start listening for the peer's answer right away
+    WakeSelect();
 
     return true;
 }
@@ -2025,10 +2244,16 @@ bool CConnman::OpenGoldminenodeConnection(const CAddress &addrConnect) {
     return OpenNetworkConnection(addrConnect, false, NULL, NULL, false, false, false, true);
 }
 
-void CConnman::ThreadMessageHandler()
+void CConnman::ThreadMessageHandler(int nWorker)
 {
     while (!flagInterruptMsgProc)
     {
+        uint64_t nWakeSeen;
+        {
+            std::lock_guard<std::mutex> lock(mutexMsgProc);
+            nWakeSeen = nMsgProcWake;
+        }
+
         std::vector<CNode*> vNodesCopy = CopyNodeVector();
 
         bool fMoreWork = false;
@@ -2038,6 +2263,11 @@ void CConnman::ThreadMessageHandler()
             if (pnode->fDisconnect)
                 continue;
 
+            // Each peer is always handled by the same worker, so its messages
+            // are processed (and answered) in the order they were received
+            if (pnode->id % nMessageHandlerThreads != nWorker)
+                continue;
+
             // Receive messages
             bool fMoreNodeWork = GetNodeSignals().ProcessMessages(pnode, *this, flagInterruptMsgProc);
             fMoreWork |= (fMoreNodeWork && !pnode->fPauseSend);
@@ -2057,9 +2287,8 @@ void CConnman::ThreadMessageHandler()
 
         std::unique_lock<std::mutex> lock(mutexMsgProc);
         if (!fMoreWork) {
-            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this] { return fMsgProcWake; });
+            condMsgProc.wait_until(lock, std::chrono::steady_clock::now() + std::chrono::milliseconds(100), [this, nWakeSeen] { return nMsgProcWake != nWakeSeen; });
         }
-        fMsgProcWake = false;
     }
 }
 
@@ -2252,9 +2481,13 @@ CConnman::CConnman(uint64_t nSeed0In, uint64_t nSeed1In) : nSeed0(nSeed0In), nSe
     nMaxConnections = 0;
     nMaxOutbound = 0;
     nMaxAddnode = 0;
+    nMessageHandlerThreads = 1;
     nBestHeight = 0;
     clientInterface = NULL;
     flagInterruptMsgProc = false;
+    epollfd = -1;
+    wakeupPipe[0] = wakeupPipe[1] = -1;
+    fWakeupPending = false;
 }
 
 NodeId CConnman::GetNewNodeId()
@@ -2275,6 +2508,7 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     nMaxOutbound = std::min((connOptions.nMaxOutbound), nMaxConnections);
     nMaxAddnode = connOptions.nMaxAddnode;
     nMaxFeeler = connOptions.nMaxFeeler;
+    nMessageHandlerThreads = std::max(1, std::min(connOptions.nMessageHandlerThreads, MAX_MSGHANDLER_THREADS));
 
     nSendBufferMaxSize = connOptions.nSendBufferMaxSize;
     nReceiveFloodSize = connOptions.nReceiveFloodSize;
@@ -2345,9 +2579,11 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
 
     {
         std::unique_lock<std::mutex> lock(mutexMsgProc);
-        fMsgProcWake = false;
+        nMsgProcWake = 0;
     }
 
+    InitSocketEvents();
+
     // Send and receive from sockets, accept connections
     threadSocketHandler = std::thread(&TraceThread<std::function<void()> >, "net", std::function<void()>(std::bind(&CConnman::ThreadSocketHandler, this)));
 
@@ -2367,7 +2603,13 @@ bool CConnman::Start(CScheduler& scheduler, std::string& strNodeError, Options c
     threadOpenGoldminenodeConnections = std::thread(&TraceThread<std::function<void()> >, "mncon", std::function<void()>(std::bind(&CConnman::ThreadOpenGoldminenodeConnections, this)));
 
     // Process messages
-    threadMessageHandler = std::thread(&TraceThread<std::function<void()> >, "msghand", std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this)));
+    for (int i = 0; i < nMessageHandlerThreads; i++) {
+        std::string strThreadName = i == 0 ? "msghand" : strprintf("msghand.%d", i);
+        // TraceThread wants a C string, keep the name alive inside the thread
+        threadMessageHandlers.push_back(std::thread([this, i, strThreadName]() {
+            TraceThread(strThreadName.c_str(), std::function<void()>(std::bind(&CConnman::ThreadMessageHandler, this, i)));
+        }));
+    }
 
     // Dump network addresses
     scheduler.scheduleEvery(boost::bind(&CConnman::DumpData, this), DUMP_ADDRESSES_INTERVAL);
@@ -2408,6 +2650,7 @@ void CConnman::Interrupt()
 
     interruptNet();
     InterruptSocks5(true);
+    WakeSelect();
 
     if (semOutbound) {
         for (int i=0; i<(nMaxOutbound + nMaxFeeler); i++) {
@@ -2430,8 +2673,11 @@ void CConnman::Interrupt()
 
 void CConnman::Stop()
 {
-    if (threadMessageHandler.joinable())
-        threadMessageHandler.join();
+    for (std::thread& threadMessageHandler : threadMessageHandlers) {
+        if (threadMessageHandler.joinable())
+            threadMessageHandler.join();
+    }
+    threadMessageHandlers.clear();
     if (threadOpenGoldminenodeConnections.joinable())
         threadOpenGoldminenodeConnections.join();
     if (threadOpenConnections.joinable())
@@ -2467,6 +2713,7 @@ void CConnman::Stop()
     vNodes.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
+    CloseSocketEvents();
     delete semOutbound;
     semOutbound = NULL;
     delete semAddnode;
@@ -2809,6 +3056,9 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nMinPingUsecTime = std::numeric_limits<int64_t>::max();
     fPauseRecv = false;
     fPauseSend = false;
+    fHasPendingSend = false;
+    fSocketEventsAdded = false;
+    nSocketEvents = 0;
     nProcessQueueSize = 0;
 
     BOOST_FOREACH(const std::string &msg, getAllNetMessageTypes())
@@ -2907,10 +3157,16 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         pnode->vSendMsg.push_back(std::move(serializedHeader));
         if (nMessageSize)
             pnode->vSendMsg.push_back(std::move(msg.data));
+        pnode->fHasPendingSend = true;
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend == true)
             nBytesSent = SocketSendData(pnode);
+
+        // the rest has to wait for the socket to become writable,
+        // let the socket handler know that it should wait for that
+        if (optimisticSend && !pnode->vSendMsg.empty())
+            WakeSelect();
     }
     if (nBytesSent)
         RecordBytesSent(nBytesSent);
@@ -26,6 +26,7 @@
 #include <stdint.h>
 #include <thread>
 #include <memory>
+#include <set>
 #include <condition_variable>
 
 #ifndef WIN32
@@ -90,6 +91,10 @@ static const bool DEFAULT_BLOCKSONLY = false;
 static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Default for -msghandlerthreads, the number of threads processing peer messages */
+static const int DEFAULT_MSGHANDLER_THREADS = 1;
+/** Maximum for -msghandlerthreads */
+static const int MAX_MSGHANDLER_THREADS = 16;
 
 static const ServiceFlags REQUIRED_SERVICES = NODE_NETWORK;
 
@@ -143,6 +148,7 @@ public:
         int nMaxOutbound = 0;
         int nMaxAddnode = 0;
         int nMaxFeeler = 0;
+        int nMessageHandlerThreads = DEFAULT_MSGHANDLER_THREADS;
         int nBestHeight = 0;
         CClientUIInterface* uiInterface = nullptr;
         unsigned int nSendBufferMaxSize = 0;
@@ -394,6 +400,8 @@ public:
     unsigned int GetReceiveFloodSize() const;
 
     void WakeMessageHandler();
+    /** Interrupt the socket handler's wait, e.g. because a node has data queued for sending */
+    void WakeSelect();
 private:
     struct ListenSocket {
         SOCKET socket;
@@ -405,10 +413,16 @@ private:
     void ThreadOpenAddedConnections();
     void ProcessOneShot();
     void ThreadOpenConnections();
-    void ThreadMessageHandler();
+    void ThreadMessageHandler(int nWorker);
     void AcceptConnection(const ListenSocket& hListenSocket);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
+
+    void InitSocketEvents();
+    void CloseSocketEvents();
+    void SocketEvents(std::set<CNode*>& recv_set, std::set<CNode*>& send_set, std::set<CNode*>& error_set, std::set<SOCKET>& listen_set);
+    void SocketEventsSelect(std::set<CNode*>& recv_set, std::set<CNode*>& send_set, std::set<CNode*>& error_set, std::set<SOCKET>& listen_set);
+    void SocketEventsEpoll(std::set<CNode*>& recv_set, std::set<CNode*>& send_set, std::set<CNode*>& error_set, std::set<SOCKET>& listen_set);
     void ThreadOpenGoldminenodeConnections();
 
     uint64_t CalculateKeyedNetGroup(const CAddress& ad) const;
@@ -495,14 +509,15 @@ private:
     int nMaxOutbound;
     int nMaxAddnode;
     int nMaxFeeler;
+    int nMessageHandlerThreads;
     std::atomic<int> nBestHeight;
     CClientUIInterface* clientInterface;
 
     /** SipHasher seeds for deterministic randomness */
     const uint64_t nSeed0, nSeed1;
 
-    /** flag for waking the message processor. */
-    bool fMsgProcWake;
+    /** counter for waking the message processors, bumped on every wakeup. */
+    uint64_t nMsgProcWake;
 
     std::condition_variable condMsgProc;
     std::mutex mutexMsgProc;
@@ -510,12 +525,18 @@ private:
 
     CThreadInterrupt interruptNet;
 
+    /** epoll instance of the socket handler, -1 if select() is used */
+    int epollfd;
+    /** pipe used to interrupt the socket handler's wait, -1 if unavailable */
+    int wakeupPipe[2];
+    std::atomic<bool> fWakeupPending;
+
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadOpenGoldminenodeConnections;
-    std::thread threadMessageHandler;
+    std::vector<std::thread> threadMessageHandlers;
 };
 extern std::unique_ptr<CConnman> g_connman;
 void Discover(boost::thread_group& threadGroup);
@@ -739,6 +760,13 @@ public:
 
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // vSendMsg is not empty, lets the socket handler check for pending data without cs_vSend
+    std::atomic_bool fHasPendingSend;
+
+    // events hSocket is registered for in the socket handler's epoll set,
+    // only used by the socket handler thread
+    bool fSocketEventsAdded;
+    uint32_t nSocketEvents;
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
@@ -9,6 +9,7 @@
 #include "addrman.h"
 #include "arith_uint256.h"
 #include "blockencodings.h"
+#include "cachemap.h"
 #include "chainparams.h"
 #include "consensus/validation.h"
 #include "hash.h"
@@ -133,6 +134,19 @@ namespace {
     MapRelay mapRelay;
     /** Expiration-time ordered list of (expire time, relay map entry) pairs, protected by cs_main). */
     std::deque<std::pair<int64_t, MapRelay::iterator>> vRelayExpiration;
+
+    /** Goldminenode or InstantSend object serialized for a getdata reply */
+    struct CRelayPayload {
+        int nVersion;
+        int64_t nTimeExpire;
+        std::string strCommand;
+        std::vector<unsigned char> vchData;
+    };
+    typedef std::shared_ptr<const CRelayPayload> relay_payload_ptr;
+
+    /** Objects already served to some peer, shared by all peers, protected by cs_mapRelayPayloads. */
+    CCriticalSection cs_mapRelayPayloads;
+    CacheMap<CInv, relay_payload_ptr> mapRelayPayloads(MAX_RELAY_PAYLOADS);
 } // anon namespace
 
 //////////////////////////////////////////////////////////////////////////////
@@ -928,10 +942,16 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
         return instantsend.AlreadyHave(inv.hash);
 
     case MSG_SPORK:
-        return mapSporks.count(inv.hash);
+        {
+            LOCK(cs_mapActive);
+            return mapSporks.count(inv.hash);
+        }
 
     case MSG_GOLDMINENODE_PAYMENT_VOTE:
-        return mnpayments.mapGoldminenodePaymentVotes.count(inv.hash);
+        {
+            LOCK(cs_mapGoldminenodePaymentVotes);
+            return mnpayments.mapGoldminenodePaymentVotes.count(inv.hash);
+        }
 
     case MSG_GOLDMINENODE_PAYMENT_BLOCK:
         {
@@ -940,16 +960,25 @@ bool static AlreadyHave(const CInv& inv) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
         }
 
     case MSG_GOLDMINENODE_ANNOUNCE:
-        return mnodeman.mapSeenGoldminenodeBroadcast.count(inv.hash) && !mnodeman.IsMnbRecoveryRequested(inv.hash);
+        {
+            LOCK(mnodeman.cs_mapSeenMessages);
+            return mnodeman.mapSeenGoldminenodeBroadcast.count(inv.hash) && !mnodeman.IsMnbRecoveryRequested(inv.hash);
+        }
 
     case MSG_GOLDMINENODE_PING:
-        return mnodeman.mapSeenGoldminenodePing.count(inv.hash);
+        {
+            LOCK(mnodeman.cs_mapSeenMessages);
+            return mnodeman.mapSeenGoldminenodePing.count(inv.hash);
+        }
 
     case MSG_DSTX: {
         return static_cast<bool>(CPrivateSend::GetDSTX(inv.hash));
     }
     case MSG_GOLDMINENODE_VERIFY:
-        return mnodeman.mapSeenGoldminenodeVerification.count(inv.hash);
+        {
+            LOCK(mnodeman.cs_mapSeenMessages);
+            return mnodeman.mapSeenGoldminenodeVerification.count(inv.hash);
+        }
     }
 
     // Don't know what it is, just say we already got one
@@ -992,6 +1021,52 @@ static void RelayAddress(const CAddress& addr, bool fReachable, CConnman& connma
     connman.ForEachNodeThen(std::move(sortfunc), std::move(pushfunc));
 }
 
+/**
+ * Push the copy of inv serialized for an earlier getdata if it is still fresh and fits the peer's version.
+ * The managers forget the copy when they drop the object, so it is never served for longer than they do.
+ */
+bool static PushRelayPayload(CNode* pfrom, const CInv& inv, CConnman& connman)
+{
+    relay_payload_ptr pPayload;
+    {
+        LOCK(cs_mapRelayPayloads);
+        if (!mapRelayPayloads.Get(inv, pPayload))
+            return false;
+    }
+    if (pPayload->nVersion != pfrom->GetSendVersion() || pPayload->nTimeExpire < GetTime())
+        return false;
+
+    CSerializedNetMsg msg;
+    msg.command = pPayload->strCommand;
+    // the send queue of each peer owns its buffers, so the cached bytes are copied but not serialized again
+    msg.data = pPayload->vchData;
+    connman.PushMessage(pfrom, std::move(msg));
+    return true;
+}
+
+/** Push a freshly serialized object and keep a copy for the next peer asking for it */
+void static PushAndCacheRelayPayload(CNode* pfrom, const CInv& inv, CSerializedNetMsg&& msg, CConnman& connman)
+{
+    std::shared_ptr<CRelayPayload> pPayload = std::make_shared<CRelayPayload>();
+    pPayload->nVersion = pfrom->GetSendVersion();
+    pPayload->nTimeExpire = GetTime() + RELAY_PAYLOAD_EXPIRY;
+    pPayload->strCommand = msg.command;
+    pPayload->vchData = msg.data;
+    {
+        LOCK(cs_mapRelayPayloads);
+        // Insert() doesn't replace, an expired or other version copy has to go first
+        mapRelayPayloads.Erase(inv);
+        mapRelayPayloads.Insert(inv, pPayload);
+    }
+    connman.PushMessage(pfrom, std::move(msg));
+}
+
+void ForgetRelayPayload(const CInv& inv)
+{
+    LOCK(cs_mapRelayPayloads);
+    mapRelayPayloads.Erase(inv);
+}
+
 void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParams, CConnman& connman, const std::atomic<bool>& interruptMsgProc)
 {
     std::deque<CInv>::iterator it = pfrom->vRecvGetData.begin();
@@ -1142,6 +1217,14 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                     }
                 }
 
+                // Goldminenode and InstantSend objects are usually requested by many peers
+                // at once, reuse what was serialized for the previous one
+                if (!push && (inv.type == MSG_TXLOCK_VOTE || inv.type == MSG_GOLDMINENODE_PAYMENT_VOTE ||
+                              inv.type == MSG_GOLDMINENODE_ANNOUNCE || inv.type == MSG_GOLDMINENODE_PING ||
+                              inv.type == MSG_GOLDMINENODE_VERIFY)) {
+                    push = PushRelayPayload(pfrom, inv, connman);
+                }
+
                 if (!push && inv.type == MSG_TXLOCK_REQUEST) {
                     CTxLockRequest txLockRequest;
                     if(instantsend.GetTxLockRequest(inv.hash, txLockRequest)) {
@@ -1153,21 +1236,29 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 if (!push && inv.type == MSG_TXLOCK_VOTE) {
                     CTxLockVote vote;
                     if(instantsend.GetTxLockVote(inv.hash, vote)) {
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::TXLOCKVOTE, vote));
+                        PushAndCacheRelayPayload(pfrom, inv, msgMaker.Make(NetMsgType::TXLOCKVOTE, vote), connman);
                         push = true;
                     }
                 }
 
                 if (!push && inv.type == MSG_SPORK) {
-                    if(mapSporks.count(inv.hash)) {
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, mapSporks[inv.hash]));
-                        push = true;
+                    CSporkMessage spork;
+                    {
+                        LOCK(cs_mapActive);
+                        std::map<uint256, CSporkMessage>::iterator it = mapSporks.find(inv.hash);
+                        if(it != mapSporks.end()) {
+                            spork = it->second;
+                            push = true;
+                        }
+                    }
+                    if(push) {
+                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::SPORK, spork));
                     }
                 }
 
                 if (!push && inv.type == MSG_GOLDMINENODE_PAYMENT_VOTE) {
                     if(mnpayments.HasVerifiedPaymentVote(inv.hash)) {
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GOLDMINENODEPAYMENTVOTE, mnpayments.mapGoldminenodePaymentVotes[inv.hash]));
+                        PushAndCacheRelayPayload(pfrom, inv, msgMaker.Make(NetMsgType::GOLDMINENODEPAYMENTVOTE, mnpayments.mapGoldminenodePaymentVotes[inv.hash]), connman);
                         push = true;
                     }
                 }
@@ -1179,8 +1270,10 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                         BOOST_FOREACH(CGoldminenodePayee& payee, mnpayments.mapGoldminenodeBlocks[mi->second->nHeight].vecPayees) {
                             std::vector<uint256> vecVoteHashes = payee.GetVoteHashes();
                             BOOST_FOREACH(uint256& hash, vecVoteHashes) {
+                                CInv invVote(MSG_GOLDMINENODE_PAYMENT_VOTE, hash);
+                                if(PushRelayPayload(pfrom, invVote, connman)) continue;
                                 if(mnpayments.HasVerifiedPaymentVote(hash)) {
-                                    connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::GOLDMINENODEPAYMENTVOTE, mnpayments.mapGoldminenodePaymentVotes[hash]));
+                                    PushAndCacheRelayPayload(pfrom, invVote, msgMaker.Make(NetMsgType::GOLDMINENODEPAYMENTVOTE, mnpayments.mapGoldminenodePaymentVotes[hash]), connman);
                                 }
                             }
                         }
@@ -1189,15 +1282,17 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
 
                 if (!push && inv.type == MSG_GOLDMINENODE_ANNOUNCE) {
+                    LOCK(mnodeman.cs_mapSeenMessages);
                     if(mnodeman.mapSeenGoldminenodeBroadcast.count(inv.hash)){
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNANNOUNCE, mnodeman.mapSeenGoldminenodeBroadcast[inv.hash].second));
+                        PushAndCacheRelayPayload(pfrom, inv, msgMaker.Make(NetMsgType::MNANNOUNCE, mnodeman.mapSeenGoldminenodeBroadcast[inv.hash].second), connman);
                         push = true;
                     }
                 }
 
                 if (!push && inv.type == MSG_GOLDMINENODE_PING) {
+                    LOCK(mnodeman.cs_mapSeenMessages);
                     if(mnodeman.mapSeenGoldminenodePing.count(inv.hash)) {
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNPING, mnodeman.mapSeenGoldminenodePing[inv.hash]));
+                        PushAndCacheRelayPayload(pfrom, inv, msgMaker.Make(NetMsgType::MNPING, mnodeman.mapSeenGoldminenodePing[inv.hash]), connman);
                         push = true;
                     }
                 }
@@ -1211,8 +1306,9 @@ void static ProcessGetData(CNode* pfrom, const Consensus::Params& consensusParam
                 }
 
                 if (!push && inv.type == MSG_GOLDMINENODE_VERIFY) {
+                    LOCK(mnodeman.cs_mapSeenMessages);
                     if(mnodeman.mapSeenGoldminenodeVerification.count(inv.hash)) {
-                        connman.PushMessage(pfrom, msgMaker.Make(NetMsgType::MNVERIFY, mnodeman.mapSeenGoldminenodeVerification[inv.hash]));
+                        PushAndCacheRelayPayload(pfrom, inv, msgMaker.Make(NetMsgType::MNVERIFY, mnodeman.mapSeenGoldminenodeVerification[inv.hash]), connman);
                         push = true;
                     }
                 }
@@ -2797,7 +2893,7 @@ bool static ProcessMessage(CNode* pfrom, const std::string& strCommand, CDataStr
             mnpayments.ProcessMessage(pfrom, strCommand, vRecv, connman);
             instantsend.ProcessMessage(pfrom, strCommand, vRecv, connman);
             sporkManager.ProcessSpork(pfrom, strCommand, vRecv, connman);
-            goldminenodeSync.ProcessMessage(pfrom, strCommand, vRecv);
+            goldminenodeSync.ProcessMessage(pfrom, strCommand, vRecv, connman);
         }
         else
         {
@@ -2873,7 +2969,10 @@ bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& i
             // Just take one message
             msgs.splice(msgs.begin(), pfrom->vProcessMsg, pfrom->vProcessMsg.begin());
             pfrom->nProcessQueueSize -= msgs.front().vRecv.size() + CMessageHeader::HEADER_SIZE;
+            bool fWasPaused = pfrom->fPauseRecv;
             pfrom->fPauseRecv = pfrom->nProcessQueueSize > connman.GetReceiveFloodSize();
+            if (fWasPaused && !pfrom->fPauseRecv)
+                connman.WakeSelect();
             fMoreWork = !pfrom->vProcessMsg.empty();
         }
         CNetMessage& msg(msgs.front());
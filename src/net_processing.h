@@ -24,6 +24,11 @@ static constexpr int64_t HEADERS_DOWNLOAD_TIMEOUT_PER_HEADER = 1000; // 1ms/head
 /** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
 static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
 
+/** Maximum number of serialized goldminenode and InstantSend objects kept for getdata replies */
+static const unsigned int MAX_RELAY_PAYLOADS = 20000;
+/** For how long a serialized object is served before it is looked up and serialized again, in seconds */
+static const int64_t RELAY_PAYLOAD_EXPIRY = 60;
+
 /** Register with a network node to receive its signals */
 void RegisterNodeSignals(CNodeSignals& nodeSignals);
 /** Unregister a network node */
@@ -53,6 +58,8 @@ struct CNodeStateStats {
 bool GetNodeStateStats(NodeId nodeid, CNodeStateStats &stats);
 /** Increase a node's misbehavior score. */
 void Misbehaving(NodeId nodeid, int howmuch);
+/** Drop the serialized copy of an object served to getdata, must be called when the object behind inv changes or is removed */
+void ForgetRelayPayload(const CInv& inv);
 
 /** Process protocol messages received from a given node */
 bool ProcessMessages(CNode* pfrom, CConnman& connman, const std::atomic<bool>& interrupt);
@@ -10,9 +10,51 @@
 #include "utilstrencodings.h"
 #include "crypto/common.h"
 
+/** Serialized size of the hashed header fields, nVersion through nNonce. */
+static const size_t BLOCK_HEADER_SIZE = 80;
+
+struct CBlockHeader::CachedHash
+{
+    unsigned char header[BLOCK_HEADER_SIZE];
+    uint256 hash;
+};
+
+CBlockHeader::CBlockHeader(const CBlockHeader& other) :
+    nVersion(other.nVersion),
+    hashPrevBlock(other.hashPrevBlock),
+    hashMerkleRoot(other.hashMerkleRoot),
+    nTime(other.nTime),
+    nBits(other.nBits),
+    nNonce(other.nNonce),
+    cachedHash(std::atomic_load(&other.cachedHash))
+{
+}
+
+CBlockHeader& CBlockHeader::operator=(const CBlockHeader& other)
+{
+    nVersion = other.nVersion;
+    hashPrevBlock = other.hashPrevBlock;
+    hashMerkleRoot = other.hashMerkleRoot;
+    nTime = other.nTime;
+    nBits = other.nBits;
+    nNonce = other.nNonce;
+    std::atomic_store(&cachedHash, std::atomic_load(&other.cachedHash));
+    return *this;
+}
+
 uint256 CBlockHeader::GetHash() const
 {
-    return HashX11(BEGIN(nVersion), END(nNonce));
+    // Blocks are shared between threads as shared_ptr<const CBlock>, so the
+    // cache is only ever replaced as a whole and accessed atomically.
+    std::shared_ptr<const CachedHash> cached = std::atomic_load(&cachedHash);
+    if (cached && memcmp(cached->header, BEGIN(nVersion), BLOCK_HEADER_SIZE) == 0)
+        return cached->hash;
+
+    std::shared_ptr<CachedHash> entry = std::make_shared<CachedHash>();
+    memcpy(entry->header, BEGIN(nVersion), BLOCK_HEADER_SIZE);
+    entry->hash = HashX11(BEGIN(nVersion), END(nNonce));
+    std::atomic_store(&cachedHash, std::shared_ptr<const CachedHash>(entry));
+    return entry->hash;
 }
 
 std::string CBlock::ToString() const
@@ -10,6 +10,8 @@
 #include "serialize.h"
 #include "uint256.h"
 
+#include <memory>
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -28,11 +30,20 @@ public:
     uint32_t nBits;
     uint32_t nNonce;
 
+private:
+    // memory only
+    struct CachedHash;
+    mutable std::shared_ptr<const CachedHash> cachedHash;
+
+public:
     CBlockHeader()
     {
         SetNull();
     }
 
+    CBlockHeader(const CBlockHeader& other);
+    CBlockHeader& operator=(const CBlockHeader& other);
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -53,6 +64,7 @@ public:
         nTime = 0;
         nBits = 0;
         nNonce = 0;
+        std::atomic_store(&cachedHash, std::shared_ptr<const CachedHash>());
     }
 
     bool IsNull() const
@@ -60,6 +72,9 @@ public:
         return (nBits == 0);
     }
 
+    /** Return the X11 hash of the header. The result is memoized together with
+     *  the header fields it was computed from, so repeated calls on an
+     *  unmodified header are cheap and direct field writes invalidate it. */
     uint256 GetHash() const;
 
     int64_t GetBlockTime() const
@@ -110,14 +125,7 @@ public:
 
     CBlockHeader GetBlockHeader() const
     {
-        CBlockHeader block;
-        block.nVersion       = nVersion;
-        block.hashPrevBlock  = hashPrevBlock;
-        block.hashMerkleRoot = hashMerkleRoot;
-        block.nTime          = nTime;
-        block.nBits          = nBits;
-        block.nNonce         = nNonce;
-        return block;
+        return *this;
     }
 
     std::string ToString() const;
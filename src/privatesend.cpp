@@ -557,6 +557,11 @@ void ThreadCheckPrivateSend(CConnman& connman)
             if(fGoldminenodeMode && (nTick % (60 * 5) == 0)) {
                 mnodeman.DoFullVerificationStep(connman);
             }
+            // write out what changed in the largest caches, so that shutdown only has to write what is left
+            if(nTick % (60 * 15) == 0) {
+                mnodeman.DumpSeenBroadcasts();
+                mnpayments.DumpPaymentVotes();
+            }
         }
     }
 }
@@ -66,6 +66,8 @@ const char *DSQUEUE="dsq";
 const char *DSEG="dseg";
 const char *SYNCSTATUSCOUNT="ssc";
 const char *MNVERIFY="mnv";
+const char *GETMNLIST="getmnlist";
+const char *MNLIST="mnlist";
 };
 
 static const char* ppszTypeName[] =
@@ -145,6 +147,8 @@ const static std::string allNetMessageTypes[] = {
     NetMsgType::DSEG,
     NetMsgType::SYNCSTATUSCOUNT,
     NetMsgType::MNVERIFY,
+    NetMsgType::GETMNLIST,
+    NetMsgType::MNLIST,
 };
 const static std::vector<std::string> allNetMessageTypesVec(allNetMessageTypes, allNetMessageTypes+ARRAYLEN(allNetMessageTypes));
 
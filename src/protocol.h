@@ -265,6 +265,8 @@ extern const char *DSQUEUE;
 extern const char *DSEG;
 extern const char *SYNCSTATUSCOUNT;
 extern const char *MNVERIFY;
+extern const char *GETMNLIST;
+extern const char *MNLIST;
 };
 
 /* Get a vector of all valid message types (see above) */
@@ -289,10 +289,10 @@ void GoldminenodeList::updateNodeList()
     ui->tableWidgetGoldminenodes->setSortingEnabled(false);
     ui->tableWidgetGoldminenodes->clearContents();
     ui->tableWidgetGoldminenodes->setRowCount(0);
-    std::map<COutPoint, CGoldminenode> mapGoldminenodes = mnodeman.GetFullGoldminenodeMap();
+    std::shared_ptr<const std::map<COutPoint, CGoldminenode> > pmapGoldminenodes = mnodeman.GetFullGoldminenodeMap();
     int offsetFromUtc = GetOffsetFromUtc();
 
-    for (const auto& mnpair : mapGoldminenodes)
+    for (const auto& mnpair : *pmapGoldminenodes)
     {
         CGoldminenode mn = mnpair.second;
         // populate list
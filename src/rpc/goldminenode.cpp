@@ -194,7 +194,7 @@ UniValue goldminenode(const JSONRPCRequest& request)
 
         int nCount;
         goldminenode_info_t mnInfo;
-        mnodeman.GetNextGoldminenodeInQueueForPayment(true, nCount, mnInfo);
+        mnodeman.GetNextGoldminenodeInQueueForPayment(true, nCount, mnInfo, true);
 
         int total = mnodeman.size();
         int ps = mnodeman.CountEnabled(MIN_PRIVATESEND_PEER_PROTO_VERSION);
@@ -544,8 +544,8 @@ UniValue goldminenodelist(const JSONRPCRequest& request)
             obj.push_back(Pair(strOutpoint, rankpair.first));
         }
     } else {
-        std::map<COutPoint, CGoldminenode> mapGoldminenodes = mnodeman.GetFullGoldminenodeMap();
-        for (const auto& mnpair : mapGoldminenodes) {
+        std::shared_ptr<const std::map<COutPoint, CGoldminenode> > pmapGoldminenodes = mnodeman.GetFullGoldminenodeMap();
+        for (const auto& mnpair : *pmapGoldminenodes) {
             CGoldminenode mn = mnpair.second;
             std::string strOutpoint = mnpair.first.ToStringShort();
             if (strMode == "activeseconds") {
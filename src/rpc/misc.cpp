@@ -7,6 +7,7 @@
 #include "base58.h"
 #include "clientversion.h"
 #include "init.h"
+#include "messagesigner.h"
 #include "net.h"
 #include "netbase.h"
 #include "rpc/server.h"
@@ -667,6 +668,91 @@ bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
     return a.second.time < b.second.time;
 }
 
+/**
+ * Paging for the address index RPCs. With a "limit" the calls read at most that
+ * many index entries and return a "cursor" to continue with. The cursor holds the
+ * position in the address list and the next index key to seek to.
+ */
+template<typename K>
+bool getAddressPageFromParams(const UniValue& params, const std::vector<std::pair<uint160, int> > &addresses,
+                              size_t &nLimit, uint32_t &nAddress, K &keyFrom)
+{
+    if (!params[0].isObject())
+        return false;
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    if (limitValue.isNull())
+        return false;
+    if (!limitValue.isNum() || limitValue.get_int64() <= 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be a positive number");
+    }
+    nLimit = limitValue.get_int64();
+
+    nAddress = 0;
+    keyFrom.SetNull();
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (!cursorValue.isNull()) {
+        if (!cursorValue.isStr() || !IsHex(cursorValue.get_str())) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        std::vector<unsigned char> vchCursor = ParseHex(cursorValue.get_str());
+        try {
+            CDataStream ssCursor(vchCursor, SER_DISK, CLIENT_VERSION);
+            ssCursor >> nAddress >> keyFrom;
+        } catch (const std::exception&) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+        }
+        if (nAddress >= addresses.size() ||
+            (!keyFrom.IsNull() && (keyFrom.hashBytes != addresses[nAddress].first || (int)keyFrom.type != addresses[nAddress].second))) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Cursor does not belong to these addresses");
+        }
+    }
+
+    return true;
+}
+
+template<typename K>
+std::string encodeAddressCursor(uint32_t nAddress, const K &keyNext)
+{
+    CDataStream ssCursor(SER_DISK, CLIENT_VERSION);
+    ssCursor << nAddress << keyNext;
+    return HexStr(ssCursor.begin(), ssCursor.end());
+}
+
+/** Read one page of address index entries for getaddressdeltas and getaddresstxids */
+std::string getAddressIndexPage(const std::vector<std::pair<uint160, int> > &addresses, int start, int end,
+                                size_t nLimit, uint32_t nAddress, CAddressIndexKey keyFrom, bool fWholeTxs,
+                                std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex)
+{
+    // as in the unpaged calls, the range only applies when both ends are given
+    if (start <= 0 || end <= 0) {
+        start = 0;
+        end = 0;
+    }
+    for (; nAddress < addresses.size(); nAddress++) {
+        if (addressIndex.size() >= nLimit) {
+            return encodeAddressCursor(nAddress, CAddressIndexKey());
+        }
+        if (keyFrom.IsNull()) {
+            keyFrom = CAddressIndexKey(addresses[nAddress].second, addresses[nAddress].first, start, 0, uint256(), 0, false);
+        }
+        CAddressIndexKey keyNext;
+        if (!GetAddressIndexPage(keyFrom, end, nLimit - addressIndex.size(), addressIndex, keyNext)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+        }
+        if (!keyNext.IsNull()) {
+            const CAddressIndexKey& keyLast = addressIndex.back().first;
+            if (fWholeTxs && keyNext.blockHeight == keyLast.blockHeight && keyNext.txindex == keyLast.txindex) {
+                // continue after the transaction instead of listing its txid again on the next page
+                keyNext = CAddressIndexKey(keyLast.type, keyLast.hashBytes, keyLast.blockHeight, keyLast.txindex + 1, uint256(), 0, false);
+            }
+            return encodeAddressCursor(nAddress, keyNext);
+        }
+        keyFrom.SetNull();
+    }
+    return "";
+}
+
 UniValue getaddressmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -751,6 +837,8 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "      \"address\"  (string) The base58check encoded address\n"
             "      ,...\n"
             "    ]\n"
+            "  \"limit\" (number, optional) Return at most this many index entries and a cursor for the rest\n"
+            "  \"cursor\" (string, optional) The cursor returned by the previous call\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -763,6 +851,8 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    \"height\"  (number) The block height\n"
             "  }\n"
             "]\n"
+            "\nWith a limit the result is an object {\"utxos\": [...], \"cursor\": \"...\"} ordered by address, the cursor\n"
+            "is left out on the last page.\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
@@ -776,13 +866,40 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
 
     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    size_t nLimit;
+    uint32_t nAddress;
+    CAddressUnspentKey keyFrom;
+    bool fPaged = getAddressPageFromParams(request.params, addresses, nLimit, nAddress, keyFrom);
+    std::string strCursor;
+
+    if (fPaged) {
+        for (; nAddress < addresses.size(); nAddress++) {
+            if (unspentOutputs.size() >= nLimit) {
+                strCursor = encodeAddressCursor(nAddress, CAddressUnspentKey());
+                break;
+            }
+            if (keyFrom.IsNull()) {
+                keyFrom = CAddressUnspentKey(addresses[nAddress].second, addresses[nAddress].first, uint256(), 0);
+            }
+            CAddressUnspentKey keyNext;
+            if (!GetAddressUnspentPage(keyFrom, nLimit - unspentOutputs.size(), unspentOutputs, keyNext)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+            if (!keyNext.IsNull()) {
+                strCursor = encodeAddressCursor(nAddress, keyNext);
+                break;
+            }
+            keyFrom.SetNull();
+        }
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
         }
-    }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+        std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
+    }
 
     UniValue result(UniValue::VARR);
 
@@ -802,6 +919,14 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         result.push_back(output);
     }
 
+    if (fPaged) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("utxos", result));
+        if (!strCursor.empty())
+            page.push_back(Pair("cursor", strCursor));
+        return page;
+    }
+
     return result;
 }
 
@@ -820,6 +945,8 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many index entries and a cursor for the rest\n"
+            "  \"cursor\" (string, optional) The cursor returned by the previous call\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -832,6 +959,8 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "\nWith a limit the result is an object {\"deltas\": [...], \"cursor\": \"...\"} ordered by address, the cursor\n"
+            "is left out on the last page.\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
@@ -860,14 +989,24 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    size_t nLimit;
+    uint32_t nAddress;
+    CAddressIndexKey keyFrom;
+    bool fPaged = getAddressPageFromParams(request.params, addresses, nLimit, nAddress, keyFrom);
+    std::string strCursor;
+
+    if (fPaged) {
+        strCursor = getAddressIndexPage(addresses, start, end, nLimit, nAddress, keyFrom, false, addressIndex);
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (start > 0 && end > 0) {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            } else {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
             }
         }
     }
@@ -890,6 +1029,14 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         result.push_back(delta);
     }
 
+    if (fPaged) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("deltas", result));
+        if (!strCursor.empty())
+            page.push_back(Pair("cursor", strCursor));
+        return page;
+    }
+
     return result;
 }
 
@@ -911,6 +1058,8 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
             "{\n"
             "  \"balance\"  (string) The current balance in duffs\n"
             "  \"received\"  (string) The total number of duffs received (including change)\n"
+            "  \"utxos\"  (number) The number of unspent outputs\n"
+            "  \"height\"  (number) The last block height the address(es) were used at\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressbalance", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
@@ -923,27 +1072,27 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-        }
-    }
-
     CAmount balance = 0;
     CAmount received = 0;
+    int64_t utxos = 0;
+    int height = 0;
 
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        if (it->second > 0) {
-            received += it->second;
+    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+        CAddressBalanceValue value;
+        if (!GetAddressBalance((*it).first, (*it).second, value)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
-        balance += it->second;
+        balance += value.balance;
+        received += value.received;
+        utxos += value.utxos;
+        height = std::max(height, value.lastHeight);
     }
 
     UniValue result(UniValue::VOBJ);
     result.push_back(Pair("balance", balance));
     result.push_back(Pair("received", received));
+    result.push_back(Pair("utxos", utxos));
+    result.push_back(Pair("height", height));
 
     return result;
 
@@ -964,12 +1113,16 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number) The start block height\n"
             "  \"end\" (number) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many index entries and a cursor for the rest\n"
+            "  \"cursor\" (string, optional) The cursor returned by the previous call\n"
             "}\n"
             "\nResult:\n"
             "[\n"
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nWith a limit the result is an object {\"txids\": [...], \"cursor\": \"...\"} ordered by address, the cursor\n"
+            "is left out on the last page.\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"XwnLY9Tf7Zsef8gMGL2fhWA9ZmMjt4KPwg\"]}")
@@ -994,14 +1147,24 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
 
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    size_t nLimit;
+    uint32_t nAddress;
+    CAddressIndexKey keyFrom;
+    bool fPaged = getAddressPageFromParams(request.params, addresses, nLimit, nAddress, keyFrom);
+    std::string strCursor;
+
+    if (fPaged) {
+        strCursor = getAddressIndexPage(addresses, start, end, nLimit, nAddress, keyFrom, true, addressIndex);
+    } else {
+        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
+            if (start > 0 && end > 0) {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
+            } else {
+                if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+                }
             }
         }
     }
@@ -1013,7 +1176,12 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         int height = it->first.blockHeight;
         std::string txid = it->first.txhash.GetHex();
 
-        if (addresses.size() > 1) {
+        if (fPaged) {
+            // pages are ordered by address, then height; entries of one transaction are adjacent
+            if (it == addressIndex.begin() || (it - 1)->first.txhash != it->first.txhash || (it - 1)->first.hashBytes != it->first.hashBytes) {
+                result.push_back(txid);
+            }
+        } else if (addresses.size() > 1) {
             txids.insert(std::make_pair(height, txid));
         } else {
             if (txids.insert(std::make_pair(height, txid)).second) {
@@ -1028,6 +1196,14 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         }
     }
 
+    if (fPaged) {
+        UniValue page(UniValue::VOBJ);
+        page.push_back(Pair("txids", result));
+        if (!strCursor.empty())
+            page.push_back(Pair("cursor", strCursor));
+        return page;
+    }
+
     return result;
 
 }
@@ -1110,6 +1286,11 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"msgsigcache\": {          (json object) Information about the goldminenode message signature cache\n"
+            "    \"elements\": xxxxx,      (numeric) Number of signatures the cache can hold\n"
+            "    \"hits\": xxxxx,          (numeric) Number of verifications answered by the cache\n"
+            "    \"misses\": xxxxx,        (numeric) Number of verifications that needed a key recovery\n"
             "  }\n"
             "}\n"
             "\nExamples:\n"
@@ -1118,6 +1299,15 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
         );
     UniValue obj(UniValue::VOBJ);
     obj.push_back(Pair("locked", RPCLockedMemoryInfo()));
+
+    uint64_t nHits, nMisses;
+    uint32_t nElements;
+    GetMessageSignatureCacheStats(nHits, nMisses, nElements);
+    UniValue msgsigcache(UniValue::VOBJ);
+    msgsigcache.push_back(Pair("elements", (uint64_t)nElements));
+    msgsigcache.push_back(Pair("hits", nHits));
+    msgsigcache.push_back(Pair("misses", nMisses));
+    obj.push_back(Pair("msgsigcache", msgsigcache));
     return obj;
 }
 
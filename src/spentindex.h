@@ -198,6 +198,10 @@ struct CAddressUnspentKey {
         txhash.SetNull();
         index = 0;
     }
+
+    bool IsNull() const {
+        return (type == 0);
+    }
 };
 
 struct CAddressUnspentValue {
@@ -296,6 +300,42 @@ struct CAddressIndexKey {
         spending = false;
     }
 
+    bool IsNull() const {
+        return (type == 0);
+    }
+
+};
+
+struct CAddressIndexKeyCompare
+{
+    bool operator()(const CAddressIndexKey& a, const CAddressIndexKey& b) const {
+        if (a.type != b.type)
+            return a.type < b.type;
+        if (a.hashBytes != b.hashBytes)
+            return a.hashBytes < b.hashBytes;
+        if (a.blockHeight != b.blockHeight)
+            return a.blockHeight < b.blockHeight;
+        if (a.txindex != b.txindex)
+            return a.txindex < b.txindex;
+        if (a.txhash != b.txhash)
+            return a.txhash < b.txhash;
+        if (a.index != b.index)
+            return a.index < b.index;
+        return a.spending < b.spending;
+    }
+};
+
+struct CAddressUnspentKeyCompare
+{
+    bool operator()(const CAddressUnspentKey& a, const CAddressUnspentKey& b) const {
+        if (a.type != b.type)
+            return a.type < b.type;
+        if (a.hashBytes != b.hashBytes)
+            return a.hashBytes < b.hashBytes;
+        if (a.txhash != b.txhash)
+            return a.txhash < b.txhash;
+        return a.index < b.index;
+    }
 };
 
 struct CAddressIndexIteratorKey {
@@ -369,5 +409,52 @@ struct CAddressIndexIteratorHeightKey {
     }
 };
 
+/** Running totals of the address index for one address, so balances don't need a history scan */
+struct CAddressBalanceValue {
+    CAmount balance;
+    CAmount received;
+    int64_t utxos;
+    int lastHeight;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(balance);
+        READWRITE(received);
+        READWRITE(utxos);
+        READWRITE(lastHeight);
+    }
+
+    CAddressBalanceValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        balance = 0;
+        received = 0;
+        utxos = 0;
+        lastHeight = 0;
+    }
+
+    bool IsNull() const {
+        return (received == 0 && utxos == 0);
+    }
+
+    /** Add (or with fUndo remove) one address index entry */
+    void Apply(const CAddressIndexKey& key, CAmount amount, bool fUndo) {
+        int nSign = fUndo ? -1 : 1;
+        balance += nSign * amount;
+        if (key.spending) {
+            utxos -= nSign;
+        } else {
+            received += nSign * amount;
+            utxos += nSign;
+        }
+        if (!fUndo && key.blockHeight > lastHeight) {
+            lastHeight = key.blockHeight;
+        }
+    }
+};
 
 #endif // BITCOIN_SPENTINDEX_H
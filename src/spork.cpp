@@ -57,15 +57,18 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             strLogMsg = strprintf("SPORK -- hash: %s id: %d value: %10d bestHeight: %d peer=%d", hash.ToString(), spork.nSporkID, spork.nValue, chainActive.Height(), pfrom->id);
         }
 
-        if(mapSporksActive.count(spork.nSporkID)) {
-            if (mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) {
-                LogPrint("spork", "%s seen\n", strLogMsg);
-                return;
+        {
+            LOCK(cs_mapActive);
+            if(mapSporksActive.count(spork.nSporkID)) {
+                if (mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned) {
+                    LogPrint("spork", "%s seen\n", strLogMsg);
+                    return;
+                } else {
+                    LogPrintf("%s updated\n", strLogMsg);
+                }
             } else {
-                LogPrintf("%s updated\n", strLogMsg);
+                LogPrintf("%s new\n", strLogMsg);
             }
-        } else {
-            LogPrintf("%s new\n", strLogMsg);
         }
 
         if(!spork.CheckSignature(sporkPubKeyID)) {
@@ -75,8 +78,14 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
             return;
         }
 
-        mapSporks[hash] = spork;
-        mapSporksActive[spork.nSporkID] = spork;
+        {
+            LOCK(cs_mapActive);
+            // another peer might have delivered the same or a newer one meanwhile
+            if (mapSporksActive.count(spork.nSporkID) && mapSporksActive[spork.nSporkID].nTimeSigned >= spork.nTimeSigned)
+                return;
+            mapSporks[hash] = spork;
+            mapSporksActive[spork.nSporkID] = spork;
+        }
 		if( spork.nSporkID == SPORK_18_EVOLUTION_PAYMENTS )
         {
 			evolutionManager.setNewEvolutions( spork.sWEvolution );
@@ -88,9 +97,15 @@ void CSporkManager::ProcessSpork(CNode* pfrom, const std::string& strCommand, CD
 
     } else if (strCommand == NetMsgType::GETSPORKS) {
 
-        std::map<int, CSporkMessage>::iterator it = mapSporksActive.begin();
+        std::map<int, CSporkMessage> mapSporksActiveCopy;
+        {
+            LOCK(cs_mapActive);
+            mapSporksActiveCopy = mapSporksActive;
+        }
 
-        while(it != mapSporksActive.end()) {
+        std::map<int, CSporkMessage>::iterator it = mapSporksActiveCopy.begin();
+
+        while(it != mapSporksActiveCopy.end()) {
             connman.PushMessage(pfrom, CNetMsgMaker(pfrom->GetSendVersion()).Make(NetMsgType::SPORK, it->second));
             it++;
         }
@@ -134,8 +149,11 @@ bool CSporkManager::UpdateSpork(int nSporkID, int64_t nValue, std::string sEvol,
 
     if(spork.Sign(sporkPrivKey)) {
         spork.Relay(connman);
-        mapSporks[spork.GetHash()] = spork;
-        mapSporksActive[nSporkID] = spork;
+        {
+            LOCK(cs_mapActive);
+            mapSporks[spork.GetHash()] = spork;
+            mapSporksActive[nSporkID] = spork;
+        }
         if(nSporkID == SPORK_18_EVOLUTION_PAYMENTS){
 			evolutionManager.setNewEvolutions( sEvol );
 		}
@@ -150,13 +168,21 @@ bool CSporkManager::IsSporkActive(int nSporkID)
 {
     int64_t r = -1;
 
-    if(mapSporksActive.count(nSporkID)){
-        r = mapSporksActive[nSporkID].nValue;
-    } else if (mapSporkDefaults.count(nSporkID)) {
-        r = mapSporkDefaults[nSporkID];
-    } else {
-        LogPrint("spork", "CSporkManager::IsSporkActive -- Unknown Spork ID %d\n", nSporkID);
-        r = 4070908800ULL; // 2099-1-1 i.e. off by default
+    bool fFound = false;
+    {
+        LOCK(cs_mapActive);
+        if(mapSporksActive.count(nSporkID)){
+            r = mapSporksActive[nSporkID].nValue;
+            fFound = true;
+        }
+    }
+    if(!fFound) {
+        if (mapSporkDefaults.count(nSporkID)) {
+            r = mapSporkDefaults[nSporkID];
+        } else {
+            LogPrint("spork", "CSporkManager::IsSporkActive -- Unknown Spork ID %d\n", nSporkID);
+            r = 4070908800ULL; // 2099-1-1 i.e. off by default
+        }
     }
     if(nSporkID != SPORK_18_EVOLUTION_PAYMENTS)
         return r < GetAdjustedTime();
@@ -167,8 +193,11 @@ bool CSporkManager::IsSporkActive(int nSporkID)
 // grab the value of the spork on the network, or the default
 int64_t CSporkManager::GetSporkValue(int nSporkID)
 {
-    if (mapSporksActive.count(nSporkID))
-        return mapSporksActive[nSporkID].nValue;
+    {
+        LOCK(cs_mapActive);
+        if (mapSporksActive.count(nSporkID))
+            return mapSporksActive[nSporkID].nValue;
+    }
 
     if (mapSporkDefaults.count(nSporkID)) {
         return mapSporkDefaults[nSporkID];
@@ -374,13 +403,11 @@ void CEvolutionManager::setNewEvolutions( const std::string &sEvol )
 	LOCK( cs_mapEvolution );
 	
 	unsigned long bComplete = 0;
-	unsigned long uCountEvolution = 0;
 	unsigned long uStart = 0;
 	
-	mapEvolution.clear();
+	vecEvolution.clear();
     if(sEvol.size()<10)
     {
-    	mapEvolution.clear();
     	return;
     }
     if(sporkManager.IsSporkActive(SPORK_18_EVOLUTION_PAYMENTS)) 
@@ -397,47 +424,84 @@ void CEvolutionManager::setNewEvolutions( const std::string &sEvol )
 		}
 
 		if( (sEvol.c_str()[i] == ',') && (bComplete == 1)  ){
-			mapEvolution.insert(  make_pair( uCountEvolution, std::string(sEvol.c_str() + uStart, i-uStart))  );
-			uCountEvolution++;
+			addEvolution( std::string(sEvol.c_str() + uStart, i-uStart) );
 			uStart = i + 1;
 		}
 
 		if(  (sEvol.c_str()[i] == ']') && (bComplete == 1)  ){
 			bComplete = 2;
-			mapEvolution.insert(  make_pair( uCountEvolution, std::string(sEvol.c_str() + uStart, i - uStart))  );
-			uCountEvolution++;
+			addEvolution( std::string(sEvol.c_str() + uStart, i - uStart) );
 		}
 	}
 }
 
+void CEvolutionManager::addEvolution( const std::string &sAddress )
+{
+	CBitcoinAddress address(sAddress);
+
+	CEvolutionPayee payee;
+	payee.strAddress = sAddress;
+	payee.dest = address.Get();
+	payee.fValid = address.IsValid() && CBitcoinAddress(payee.dest).ToString() == sAddress;
+	payee.scriptPubKey = GetScriptForDestination(payee.dest);
+
+	vecEvolution.push_back(payee);
+}
+
 std::string CEvolutionManager::getEvolution( int nBlockHeight )
 {	
 	LOCK( cs_mapEvolution );
-	if(mapEvolution.size()==0)
+	if(vecEvolution.empty())
 		return "";
 	else
-		return mapEvolution[ nBlockHeight%mapEvolution.size() ];
+		return vecEvolution[ nBlockHeight%vecEvolution.size() ].strAddress;
 }	
 
+bool CEvolutionManager::getEvolutionScript( int nBlockHeight, CScript& scriptRet )
+{
+	LOCK( cs_mapEvolution );
+	if(vecEvolution.empty())
+		return false;
+
+	const CEvolutionPayee& payee = vecEvolution[ nBlockHeight%vecEvolution.size() ];
+	if(payee.strAddress.empty())
+		return false;
+
+	scriptRet = payee.scriptPubKey;
+	return true;
+}
+
 bool CEvolutionManager::IsTransactionValid( const CTransaction& txNew, int nBlockHeight, CAmount blockCurEvolution  )
 {	
 	LOCK( cs_mapEvolution );
 	
-	if( mapEvolution.size() < 1 ){ 
+	if( vecEvolution.empty() ){ 
 		return true;
 	}
-	
+
+	const CEvolutionPayee& payee = vecEvolution[ nBlockHeight%vecEvolution.size() ];
+
+	// an output without a destination is checked against the destination of the one before it
 	CTxDestination address1;
 
 	for( unsigned int i = 0; i < txNew.vout.size(); i++ )
 	{	
-		ExtractDestination(txNew.vout[i].scriptPubKey, address1);
-		CBitcoinAddress address2(address1);
+		// the script we create ourselves, no need to decode it
+		if( payee.fValid && txNew.vout[i].scriptPubKey == payee.scriptPubKey ){
+			address1 = payee.dest;
+		}else{
+			ExtractDestination(txNew.vout[i].scriptPubKey, address1);
+		}
+
+		if( blockCurEvolution != txNew.vout[i].nValue ){
+			continue;
+		}
 
-		if(  ( mapEvolution[nBlockHeight%mapEvolution.size()] == address2.ToString() ) && (blockCurEvolution == txNew.vout[i].nValue)  ){
+		// an address string that is not in canonical form never matched an encoded destination
+		if( payee.fValid ? address1 == payee.dest : CBitcoinAddress(address1).ToString() == payee.strAddress ){
 			return true;
 		}
-	}	
+	}
 
 	return false;
 }
@@ -9,6 +9,7 @@
 #include "net.h"
 #include "utilstrencodings.h"
 #include "key.h"
+#include "script/standard.h"
 
 class CSporkMessage;
 class CSporkManager;
@@ -40,6 +41,8 @@ static const int SPORK_START                                            = SPORK_
 static const int SPORK_END                                              = SPORK_24_UPGRADE;
 
 extern std::map<int, int64_t> mapSporkDefaults;
+// protects mapSporks and CSporkManager::mapSporksActive
+extern CCriticalSection cs_mapActive;
 extern std::map<uint256, CSporkMessage> mapSporks;
 extern CSporkManager sporkManager;
 extern CEvolutionManager evolutionManager;
@@ -123,7 +126,19 @@ public:
 class CEvolutionManager
 {
 private:
-	std::map<int, std::string> mapEvolution;
+	// evolution payee, resolved once when the spork string is set
+	struct CEvolutionPayee
+	{
+		std::string strAddress;
+		CTxDestination dest;
+		CScript scriptPubKey;
+		// strAddress is exactly how dest encodes, so destinations can be compared instead of strings
+		bool fValid;
+	};
+
+	std::vector<CEvolutionPayee> vecEvolution;
+
+	void addEvolution( const std::string &sAddress );
 
 public:
 
@@ -131,6 +146,7 @@ public:
 	
 	void setNewEvolutions( const std::string &sEvol );
 	std::string getEvolution( int nBlockHeight );
+	bool getEvolutionScript( int nBlockHeight, CScript& scriptRet );
 	bool IsTransactionValid( const CTransaction& txNew, int nBlockHeight, CAmount blockCurEvolution );
 	bool checkEvolutionString( const std::string &sEvol );
 };
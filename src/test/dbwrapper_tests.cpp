@@ -3,8 +3,15 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "dbwrapper.h"
+#include "chain.h"
+#include "flat-database.h"
+#include "key.h"
+#include "script/standard.h"
+#include "txdb.h"
 #include "uint256.h"
+#include "undo.h"
 #include "random.h"
+#include "validation.h"
 #include "test/test_arc.h"
 
 #include <boost/assign/std/vector.hpp> // for 'operator+=()'
@@ -320,4 +327,361 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
 
 
 
+BOOST_FIXTURE_TEST_CASE(address_balance_index, TestingSetup)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 hashA = uint160(std::vector<unsigned char>(20, 0xaa));
+    uint160 hashB = uint160(std::vector<unsigned char>(20, 0xbb));
+    uint256 txid1 = GetRandHash(), txid2 = GetRandHash();
+
+    // receive 50 at height 10, spend it and receive 20 change at height 12
+    std::vector<std::pair<CAddressIndexKey, CAmount> > block10, block12;
+    block10.push_back(std::make_pair(CAddressIndexKey(1, hashA, 10, 0, txid1, 0, false), 50));
+    block10.push_back(std::make_pair(CAddressIndexKey(2, hashB, 10, 0, txid1, 1, false), 7));
+    block12.push_back(std::make_pair(CAddressIndexKey(1, hashA, 12, 1, txid2, 0, true), -50));
+    block12.push_back(std::make_pair(CAddressIndexKey(1, hashA, 12, 1, txid2, 0, false), 20));
+    BOOST_CHECK(db.WriteAddressIndex(block10));
+    BOOST_CHECK(db.WriteAddressIndex(block12));
+
+    CAddressBalanceValue value;
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 20);
+    BOOST_CHECK_EQUAL(value.received, 70);
+    BOOST_CHECK_EQUAL(value.utxos, 1);
+    BOOST_CHECK_EQUAL(value.lastHeight, 12);
+
+    // aggregates must match the history they summarize
+    std::vector<std::pair<CAddressIndexKey, CAmount> > history;
+    BOOST_CHECK(db.ReadAddressIndex(hashA, 1, history));
+    CAmount nSum = 0;
+    for (size_t i = 0; i < history.size(); i++)
+        nSum += history[i].second;
+    BOOST_CHECK_EQUAL(nSum, value.balance);
+
+    // paging through the same history one entry at a time
+    std::vector<std::pair<CAddressIndexKey, CAmount> > page;
+    CAddressIndexKey keyFrom(1, hashA, 0, 0, uint256(), 0, false), keyNext;
+    do {
+        BOOST_CHECK(db.ReadAddressIndexPage(keyFrom, 0, 1, page, keyNext));
+        keyFrom = keyNext;
+    } while (!keyNext.IsNull());
+    BOOST_CHECK_EQUAL(page.size(), history.size());
+    for (size_t i = 0; i < history.size() && i < page.size(); i++)
+        BOOST_CHECK(page[i].first.txhash == history[i].first.txhash && page[i].second == history[i].second);
+
+    // disconnecting block 12 restores the previous totals and last height
+    BOOST_CHECK(db.EraseAddressIndex(block12));
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 50);
+    BOOST_CHECK_EQUAL(value.received, 50);
+    BOOST_CHECK_EQUAL(value.utxos, 1);
+    BOOST_CHECK_EQUAL(value.lastHeight, 10);
+
+    // disconnecting everything removes the entries
+    BOOST_CHECK(db.EraseAddressIndex(block10));
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, value));
+    BOOST_CHECK(value.IsNull());
+    BOOST_CHECK_EQUAL(value.lastHeight, 0);
+
+    // building from the history gives the same result as incremental updates
+    BOOST_CHECK(db.WriteAddressIndex(block10));
+    BOOST_CHECK(db.WriteAddressIndex(block12));
+    BOOST_CHECK(db.BuildAddressBalances());
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 20);
+    BOOST_CHECK_EQUAL(value.utxos, 1);
+    BOOST_CHECK_EQUAL(value.lastHeight, 12);
+    BOOST_CHECK(db.ReadAddressBalance(hashB, 2, value));
+    BOOST_CHECK_EQUAL(value.balance, 7);
+    BOOST_CHECK_EQUAL(value.lastHeight, 10);
+}
+
+BOOST_FIXTURE_TEST_CASE(separate_index_db, TestingSetup)
+{
+    CBlockTreeDB db(1 << 20, true, false, 1 << 20);
+    uint160 hashA = uint160(std::vector<unsigned char>(20, 0xaa));
+    uint256 txid = GetRandHash(), hashBlock = GetRandHash();
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vAddressIndex;
+    vAddressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashA, 10, 0, txid, 0, false), 50));
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > vSpentIndex;
+    vSpentIndex.push_back(std::make_pair(CSpentIndexKey(txid, 0), CSpentIndexValue(GetRandHash(), 0, 11, 50, 1, hashA)));
+    BOOST_CHECK(db.WriteAddressIndex(vAddressIndex));
+    BOOST_CHECK(db.UpdateSpentIndex(vSpentIndex));
+    BOOST_CHECK(db.WriteTimestampIndex(CTimestampIndexKey(1000, hashBlock)));
+
+    // the block tree itself stays untouched
+    BOOST_CHECK(db.IsEmpty());
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > history;
+    BOOST_CHECK(db.ReadAddressIndex(hashA, 1, history));
+    BOOST_CHECK_EQUAL(history.size(), 1);
+    CAddressBalanceValue value;
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 50);
+    CSpentIndexKey spentKey(txid, 0);
+    CSpentIndexValue spentValue;
+    BOOST_CHECK(db.ReadSpentIndex(spentKey, spentValue));
+    BOOST_CHECK_EQUAL(spentValue.blockHeight, 11);
+    std::vector<uint256> hashes;
+    BOOST_CHECK(db.ReadTimestampIndex(2000, 0, hashes));
+    BOOST_CHECK(hashes.size() == 1 && hashes[0] == hashBlock);
+}
+
+BOOST_FIXTURE_TEST_CASE(index_build_rows, TestingSetup)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 hashA = uint160(std::vector<unsigned char>(20, 0xaa));
+    uint256 txid1 = GetRandHash(), txid2 = GetRandHash(), hashBlock = GetRandHash();
+    CScript script = CScript() << OP_DUP << OP_HASH160 << ToByteVector(hashA) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    // an output written earlier, spent by txid2
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vUnspent;
+    vUnspent.push_back(std::make_pair(CAddressUnspentKey(1, hashA, txid1, 0), CAddressUnspentValue(50, script, 10)));
+    BOOST_CHECK(db.UpdateAddressUnspentIndex(vUnspent));
+
+    // txid2 creates two outputs, the first one is spent again right away
+    CIndexRows rows;
+    rows.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashA, 12, 1, txid2, 0, true), -50));
+    rows.RemoveUnspent(CAddressUnspentKey(1, hashA, txid1, 0));
+    rows.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashA, 12, 1, txid2, 0, false), 30));
+    rows.AddUnspent(CAddressUnspentKey(1, hashA, txid2, 0), CAddressUnspentValue(30, script, 12));
+    rows.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashA, 12, 1, txid2, 1, false), 20));
+    rows.AddUnspent(CAddressUnspentKey(1, hashA, txid2, 1), CAddressUnspentValue(20, script, 12));
+    rows.RemoveUnspent(CAddressUnspentKey(1, hashA, txid2, 0));
+    rows.vTimestampIndex.push_back(CTimestampIndexKey(1000, hashBlock));
+    BOOST_CHECK_EQUAL(rows.mapAddressUnspentIndex.size(), 2);
+    BOOST_CHECK_EQUAL(rows.Count(), 6);
+
+    int nIndexes;
+    uint256 hashBuild;
+    BOOST_CHECK(!db.ReadIndexBuild(nIndexes, hashBuild));
+    BOOST_CHECK(db.WriteIndexRows(rows, 5, hashBlock));
+    BOOST_CHECK(db.ReadIndexBuild(nIndexes, hashBuild));
+    BOOST_CHECK_EQUAL(nIndexes, 5);
+    BOOST_CHECK(hashBuild == hashBlock);
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspent;
+    BOOST_CHECK(db.ReadAddressUnspentIndex(hashA, 1, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), 1);
+    BOOST_CHECK(unspent.size() == 1 && unspent[0].first.txhash == txid2 && unspent[0].first.index == 1);
+    CAddressBalanceValue value;
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, value));
+    BOOST_CHECK_EQUAL(value.received, 50);
+    BOOST_CHECK_EQUAL(value.lastHeight, 12);
+    std::vector<uint256> hashes;
+    BOOST_CHECK(db.ReadTimestampIndex(2000, 0, hashes));
+    BOOST_CHECK_EQUAL(hashes.size(), 1);
+
+    BOOST_CHECK(db.EraseIndexBuild());
+    BOOST_CHECK(!db.ReadIndexBuild(nIndexes, hashBuild));
+}
+
+BOOST_FIXTURE_TEST_CASE(index_best_block, TestingSetup)
+{
+    CBlockTreeDB db(1 << 20, true);
+    uint160 hashA = uint160(std::vector<unsigned char>(20, 0xaa));
+    uint256 hashBlock1 = GetRandHash(), hashBlock2 = GetRandHash();
+
+    // rows of two blocks flushed together, the same address in both
+    CIndexRows rows;
+    rows.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashA, 2, 0, GetRandHash(), 0, false), 20));
+    rows.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashA, 1, 0, GetRandHash(), 0, false), 10));
+    rows.vTimestampIndex.push_back(CTimestampIndexKey(1000, hashBlock1));
+    rows.vTimestampIndex.push_back(CTimestampIndexKey(1001, hashBlock2));
+    BOOST_CHECK(rows.DynamicMemoryUsage() > 0);
+
+    uint256 hashBest;
+    BOOST_CHECK(!db.ReadIndexBestBlock(hashBest));
+    BOOST_CHECK(db.WriteIndexRows(rows, hashBlock2));
+    BOOST_CHECK(db.ReadIndexBestBlock(hashBest));
+    BOOST_CHECK(hashBest == hashBlock2);
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > history;
+    BOOST_CHECK(db.ReadAddressIndex(hashA, 1, history));
+    BOOST_CHECK(history.size() == 2 && history[0].first.blockHeight == 1 && history[1].first.blockHeight == 2);
+    CAddressBalanceValue value;
+    BOOST_CHECK(db.ReadAddressBalance(hashA, 1, value));
+    BOOST_CHECK_EQUAL(value.balance, 30);
+    BOOST_CHECK_EQUAL(value.lastHeight, 2);
+
+    // disconnecting the last block moves the marker back
+    BOOST_CHECK(db.WriteIndexBestBlock(hashBlock1));
+    BOOST_CHECK(db.ReadIndexBestBlock(hashBest));
+    BOOST_CHECK(hashBest == hashBlock1);
+}
+
+BOOST_FIXTURE_TEST_CASE(index_block_rows, TestingSetup)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CScript scriptP2PK = CScript() << ToByteVector(key.GetPubKey()) << OP_CHECKSIG;
+    CScript scriptP2PKH = GetScriptForDestination(key.GetPubKey().GetID());
+    CScript scriptP2SH = GetScriptForDestination(CScriptID(scriptP2PK));
+    CScript scriptOther = CScript() << OP_TRUE;
+    uint160 hashKey = key.GetPubKey().GetID(), hashScript = CScriptID(scriptP2PK);
+
+    uint160 hashBytes;
+    BOOST_CHECK_EQUAL(GetIndexAddress(scriptP2PKH, hashBytes), 1);
+    BOOST_CHECK(hashBytes == hashKey);
+    BOOST_CHECK_EQUAL(GetIndexAddress(scriptP2PK, hashBytes), 1);
+    BOOST_CHECK(hashBytes == hashKey);
+    BOOST_CHECK_EQUAL(GetIndexAddress(scriptP2SH, hashBytes), 2);
+    BOOST_CHECK(hashBytes == hashScript);
+    BOOST_CHECK_EQUAL(GetIndexAddress(scriptOther, hashBytes), 0);
+    BOOST_CHECK(hashBytes.IsNull());
+
+    // outputs of an earlier block, one of each kind
+    CCoinsView viewDummy;
+    CCoinsViewCache view(&viewDummy);
+    uint256 txidPrev = GetRandHash();
+    view.AddCoin(COutPoint(txidPrev, 0), Coin(CTxOut(10, scriptP2PKH), 5, false), false);
+    view.AddCoin(COutPoint(txidPrev, 1), Coin(CTxOut(20, scriptP2SH), 5, false), false);
+    view.AddCoin(COutPoint(txidPrev, 2), Coin(CTxOut(30, scriptP2PK), 5, false), false);
+    view.AddCoin(COutPoint(txidPrev, 3), Coin(CTxOut(40, scriptOther), 5, false), false);
+
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].prevout.SetNull();
+    coinbase.vout.push_back(CTxOut(50, scriptP2PKH));
+    // spends the earlier outputs, its first output is spent again in the same block
+    CMutableTransaction tx1;
+    for (unsigned int n = 0; n < 4; n++)
+        tx1.vin.push_back(CTxIn(COutPoint(txidPrev, n)));
+    tx1.vout.push_back(CTxOut(60, scriptP2SH));
+    tx1.vout.push_back(CTxOut(35, scriptP2PKH));
+    CMutableTransaction tx2;
+    tx2.vin.push_back(CTxIn(COutPoint(tx1.GetHash(), 0)));
+    tx2.vout.push_back(CTxOut(55, scriptOther));
+
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    block.vtx.push_back(MakeTransactionRef(tx1));
+    block.vtx.push_back(MakeTransactionRef(tx2));
+    uint256 hashBlock = block.GetHash();
+    CBlockIndex index;
+    index.nHeight = 6;
+    index.nTime = 1000;
+    index.phashBlock = &hashBlock;
+
+    // the undo data as ConnectBlock records it
+    CBlockUndo blockundo;
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction& tx = *block.vtx[i];
+        if (i > 0) {
+            blockundo.vtxundo.push_back(CTxUndo());
+            for (unsigned int j = 0; j < tx.vin.size(); j++) {
+                blockundo.vtxundo.back().vprevout.emplace_back();
+                BOOST_CHECK(view.SpendCoin(tx.vin[j].prevout, &blockundo.vtxundo.back().vprevout.back()));
+            }
+        }
+        AddCoins(view, tx, index.nHeight);
+    }
+
+    CIndexRows rows;
+    BOOST_CHECK(AddBlockIndexRows(rows, block, blockundo, &index, true, true, true));
+
+    // received by the coinbase and tx1, spent by tx1 and tx2, the bare script has no address
+    BOOST_CHECK_EQUAL(rows.vAddressIndex.size(), 7);
+    CAmount nKeyDelta = 0, nScriptDelta = 0;
+    for (unsigned int n = 0; n < rows.vAddressIndex.size(); n++) {
+        const CAddressIndexKey& indexKey = rows.vAddressIndex[n].first;
+        BOOST_CHECK_EQUAL(indexKey.blockHeight, 6);
+        BOOST_CHECK_EQUAL(indexKey.spending, rows.vAddressIndex[n].second < 0);
+        (indexKey.type == 2 ? nScriptDelta : nKeyDelta) += rows.vAddressIndex[n].second;
+    }
+    BOOST_CHECK_EQUAL(nKeyDelta, 50 + 35 - 10 - 30);
+    BOOST_CHECK_EQUAL(nScriptDelta, 60 - 20 - 60);
+
+    // three outputs erased, two created, tx1's first output never shows up
+    BOOST_CHECK_EQUAL(rows.mapAddressUnspentIndex.size(), 5);
+    BOOST_CHECK(rows.mapAddressUnspentIndex.count(CAddressUnspentKey(2, hashScript, tx1.GetHash(), 0)) == 0);
+    BOOST_CHECK(rows.mapAddressUnspentIndex[CAddressUnspentKey(2, hashScript, txidPrev, 1)].IsNull());
+    BOOST_CHECK(rows.mapAddressUnspentIndex[CAddressUnspentKey(1, hashKey, txidPrev, 2)].IsNull());
+    const CAddressUnspentValue& unspent = rows.mapAddressUnspentIndex[CAddressUnspentKey(1, hashKey, tx1.GetHash(), 1)];
+    BOOST_CHECK(unspent.satoshis == 35 && unspent.blockHeight == 6 && unspent.script == scriptP2PKH);
+
+    BOOST_CHECK_EQUAL(rows.vSpentIndex.size(), 5);
+    for (unsigned int n = 0; n < rows.vSpentIndex.size(); n++) {
+        const CSpentIndexKey& spentKey = rows.vSpentIndex[n].first;
+        const CSpentIndexValue& spentValue = rows.vSpentIndex[n].second;
+        BOOST_CHECK_EQUAL(spentValue.blockHeight, 6);
+        if (spentKey.txid == txidPrev && spentKey.outputIndex == 3)
+            BOOST_CHECK(spentValue.addressType == 0 && spentValue.addressHash.IsNull() && spentValue.satoshis == 40);
+        if (spentKey.txid == tx1.GetHash())
+            BOOST_CHECK(spentValue.txid == tx2.GetHash() && spentValue.addressType == 2 && spentValue.addressHash == hashScript);
+    }
+
+    BOOST_CHECK(rows.vTimestampIndex.size() == 1 && rows.vTimestampIndex[0].blockHash == hashBlock);
+
+    // the builder asks for a subset
+    CIndexRows rowsSpent;
+    BOOST_CHECK(AddBlockIndexRows(rowsSpent, block, blockundo, &index, false, true, false));
+    BOOST_CHECK_EQUAL(rowsSpent.Count(), 5);
+
+    // undo data that does not belong to the block
+    blockundo.vtxundo.pop_back();
+    BOOST_CHECK(!AddBlockIndexRows(rowsSpent, block, blockundo, &index, true, false, false));
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_options)
+{
+    boost::filesystem::path ph = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path();
+    ForceSetArg("-testdbbloombits", "0");
+    ForceSetArg("-testdbmaxopenfiles", "4");
+    CDBOptions dbOptions = CDBOptions::FromArgs("test", 1 << 20);
+    BOOST_CHECK_EQUAL(dbOptions.nCacheSize, 1 << 20);
+    BOOST_CHECK_EQUAL(dbOptions.nBloomBits, 0);
+    BOOST_CHECK_EQUAL(dbOptions.nMaxOpenFiles, 16);
+    CDBWrapper dbw(ph, dbOptions, true);
+    std::string strIn(4096, 'x'), strOut;
+    BOOST_CHECK(dbw.Write('k', strIn));
+    BOOST_CHECK(dbw.Read('k', strOut));
+    BOOST_CHECK(strIn == strOut);
+    BOOST_CHECK(!dbw.Exists('l'));
+}
+
+BOOST_FIXTURE_TEST_CASE(flatdbmap, TestingSetup)
+{
+    std::map<uint256, std::string> mapEntries;
+    for (int i = 0; i < 10; i++)
+        mapEntries.emplace(GetRandHash(), strprintf("entry %d", i));
+
+    // nothing was loaded, so the first write stores everything
+    CFlatDBMap<uint256, std::string> flatdb("flatdbmap");
+    BOOST_CHECK(flatdb.Write(mapEntries));
+
+    // only the keys passed to SetDirty are written again
+    std::map<uint256, std::string>::iterator it = mapEntries.begin();
+    uint256 hashChanged = (it++)->first;
+    uint256 hashUntracked = (it++)->first;
+    uint256 hashErased = it->first;
+    std::string strUntracked = mapEntries[hashUntracked];
+    mapEntries[hashChanged] = "changed";
+    flatdb.SetDirty(hashChanged);
+    mapEntries[hashUntracked] = "untracked";
+    mapEntries.erase(hashErased);
+    flatdb.SetDirty(hashErased);
+    uint256 hashAdded = GetRandHash();
+    mapEntries[hashAdded] = "added";
+    flatdb.SetDirty(hashAdded);
+    BOOST_CHECK(flatdb.Write(mapEntries));
+
+    std::map<uint256, std::string> mapLoaded;
+    CFlatDBMap<uint256, std::string> flatdbLoaded("flatdbmap");
+    BOOST_CHECK(flatdbLoaded.Load(mapLoaded));
+    BOOST_CHECK_EQUAL(mapLoaded.size(), mapEntries.size());
+    BOOST_CHECK_EQUAL(mapLoaded[hashChanged], "changed");
+    BOOST_CHECK_EQUAL(mapLoaded[hashAdded], "added");
+    BOOST_CHECK_EQUAL(mapLoaded[hashUntracked], strUntracked);
+    BOOST_CHECK(!mapLoaded.count(hashErased));
+
+    // after SetAllDirty the whole database is replaced
+    flatdb.SetAllDirty();
+    BOOST_CHECK(flatdb.Write(mapEntries));
+    mapLoaded.clear();
+    BOOST_CHECK(flatdbLoaded.Load(mapLoaded));
+    BOOST_CHECK(mapLoaded == mapEntries);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
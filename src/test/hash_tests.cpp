@@ -3,6 +3,8 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "hash.h"
+#include "crypto/common.h"
+#include "primitives/block.h"
 #include "utilstrencodings.h"
 #include "test/test_arc.h"
 
@@ -149,4 +151,58 @@ BOOST_AUTO_TEST_CASE(siphash)
     BOOST_CHECK_EQUAL(SipHashUint256(1, 2, ss.GetHash()), 0x79751e980c2a0a35ULL);
 }
 
+BOOST_AUTO_TEST_CASE(x11_batch)
+{
+    // Batched and nonce-scanning X11 hashing must match the single-shot HashX11,
+    // including a partial trailing batch.
+    const size_t nCount = X11_BATCH_LANES * 2 + 3;
+    std::vector<unsigned char> headers(80 * nCount);
+    for (size_t i = 0; i < headers.size(); i++) {
+        headers[i] = (unsigned char)(i * 31 + 7);
+    }
+
+    std::vector<uint256> hashes(nCount);
+    HashX11Headers(headers.data(), nCount, hashes.data());
+    for (size_t i = 0; i < nCount; i++) {
+        BOOST_CHECK(hashes[i] == HashX11(headers.begin() + i * 80, headers.begin() + (i + 1) * 80));
+    }
+
+    std::vector<unsigned char> header(headers.begin(), headers.begin() + 80);
+    CX11NonceHasher hasher(header.data());
+    hasher.Hash(0xfffffff0, nCount, hashes.data());
+    for (size_t i = 0; i < nCount; i++) {
+        WriteLE32(&header[76], 0xfffffff0 + i);
+        BOOST_CHECK(hashes[i] == HashX11(header.begin(), header.end()));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(blockheader_hash_cache)
+{
+    CBlockHeader header;
+    header.nVersion = 1;
+    header.hashPrevBlock = uint256S("0x1f1e1d1c1b1a191817161514131211100f0e0d0c0b0a09080706050403020100");
+    header.nTime = 1234567890;
+    header.nBits = 0x1e0ffff0;
+
+    uint256 hash = header.GetHash();
+    BOOST_CHECK(hash == HashX11(BEGIN(header.nVersion), END(header.nNonce)));
+    BOOST_CHECK(header.GetHash() == hash);
+
+    // Copies carry the cached hash along with the fields it belongs to
+    CBlock block(header);
+    BOOST_CHECK(block.GetHash() == hash);
+    BOOST_CHECK(block.GetBlockHeader().GetHash() == hash);
+
+    // Any field write invalidates the cached hash
+    header.nNonce++;
+    BOOST_CHECK(header.GetHash() != hash);
+    BOOST_CHECK(header.GetHash() == HashX11(BEGIN(header.nVersion), END(header.nNonce)));
+    BOOST_CHECK(block.GetHash() == hash);
+
+    block = CBlock(header);
+    BOOST_CHECK(block.GetHash() == header.GetHash());
+    block.SetNull();
+    BOOST_CHECK(block.GetHash() == CBlockHeader().GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 #include "key.h"
 
 #include "base58.h"
+#include "messagesigner.h"
 #include "script/script.h"
 #include "uint256.h"
 #include "util.h"
@@ -186,4 +187,32 @@ BOOST_AUTO_TEST_CASE(key_test1)
     BOOST_CHECK(detsigc == ParseHex("2052d8a32079c11e79db95af63bb9600c5b04f21a9ca33dc129c2bfa8ac9dc1cd561d8ae5e0f6c1a16bde3719c64c2fd70e404b6428ab9a69566962e8771b5944d"));
 }
 
+BOOST_AUTO_TEST_CASE(message_signature_cache)
+{
+    CKey key, key2;
+    key.MakeNewKey(true);
+    key2.MakeNewKey(true);
+    CPubKey pubkey = key.GetPubKey();
+
+    std::vector<unsigned char> vchSig;
+    std::string strError;
+    BOOST_CHECK(CMessageSigner::SignMessage("message signature cache", vchSig, key));
+
+    uint64_t nHits, nMisses, nHitsAfter, nMissesAfter;
+    uint32_t nElements;
+    GetMessageSignatureCacheStats(nHits, nMisses, nElements);
+    BOOST_CHECK(nElements > 0);
+
+    // first check recovers the key, the second one is answered by the cache
+    BOOST_CHECK(CMessageSigner::VerifyMessage(pubkey, vchSig, "message signature cache", strError));
+    BOOST_CHECK(CMessageSigner::VerifyMessage(pubkey, vchSig, "message signature cache", strError));
+    GetMessageSignatureCacheStats(nHitsAfter, nMissesAfter, nElements);
+    BOOST_CHECK_EQUAL(nMissesAfter - nMisses, 1U);
+    BOOST_CHECK_EQUAL(nHitsAfter - nHits, 1U);
+
+    // a cached signature must not validate a different message or key
+    BOOST_CHECK(!CMessageSigner::VerifyMessage(pubkey, vchSig, "another message", strError));
+    BOOST_CHECK(!CMessageSigner::VerifyMessage(key2.GetPubKey(), vchSig, "message signature cache", strError));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,10 +2,23 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "chain.h"
+#include "chainparams.h"
+#include "consensus/validation.h"
+#include "key.h"
+#include "miner.h"
 #include "net.h"
+#include "pow.h"
+#include "random.h"
+#include "script/standard.h"
+#include "txdb.h"
+#include "validation.h"
 
 #include "test/test_arc.h"
 
+#include <memory>
+#include <vector>
+
 #include <boost/signals2/signal.hpp>
 #include <boost/test/unit_test.hpp>
 
@@ -27,4 +40,150 @@ BOOST_AUTO_TEST_CASE(test_combiner_all)
     Test.disconnect(&ReturnTrue);
     BOOST_CHECK(Test());
 }
+BOOST_AUTO_TEST_CASE(getblockhash_test)
+{
+    // mining a chain takes too long with this PoW, the genesis block is enough
+    // to check that the lock free window is published together with the tip
+    LOCK(cs_main);
+    BOOST_CHECK_EQUAL(GetActiveChainHeight(), chainActive.Height());
+    BOOST_CHECK_EQUAL(GetActiveChainHeight(), 0);
+
+    uint256 hash;
+    BOOST_CHECK(GetBlockHash(hash, 0));
+    BOOST_CHECK(hash == Params().GetConsensus().hashGenesisBlock);
+    BOOST_CHECK(GetBlockHash(hash));
+    BOOST_CHECK(hash == chainActive.Tip()->GetBlockHash());
+    BOOST_CHECK(!GetBlockHash(hash, 1));
+    BOOST_CHECK(!GetBlockHash(hash, -2));
+}
+
+
+BOOST_AUTO_TEST_CASE(active_chain_hashes_test)
+{
+    const int nSlots = CActiveChainHashes::SLOTS;
+    const int nLength = nSlots * 2 + 100;
+    std::vector<uint256> vHash(nLength);
+    std::vector<CBlockIndex> vIndex(nLength);
+    for (int i = 0; i < nLength; i++) {
+        vHash[i] = GetRandHash();
+        vIndex[i].nHeight = i;
+        vIndex[i].phashBlock = &vHash[i];
+        vIndex[i].pprev = (i == 0) ? NULL : &vIndex[i - 1];
+    }
+
+    std::unique_ptr<CActiveChainHashes> hashes(new CActiveChainHashes());
+    uint256 hash;
+    BOOST_CHECK_EQUAL(hashes->Height(), -1);
+    BOOST_CHECK(!hashes->Get(0, hash));
+
+    // a chain shorter than the window
+    hashes->SetTip(&vIndex[100]);
+    BOOST_CHECK_EQUAL(hashes->Height(), 100);
+    BOOST_CHECK(hashes->Get(0, hash) && hash == vHash[0]);
+    BOOST_CHECK(hashes->Get(100, hash) && hash == vHash[100]);
+    BOOST_CHECK(!hashes->Get(101, hash));
+    BOOST_CHECK(!hashes->Get(-1, hash));
+
+    // connected one by one, the ring wraps around twice
+    for (int i = 101; i < nLength; i++)
+        hashes->SetTip(&vIndex[i]);
+    const int nTip = nLength - 1;
+    BOOST_CHECK_EQUAL(hashes->Height(), nTip);
+    int nFound = 0;
+    for (int i = nTip - nSlots + 1; i <= nTip; i++)
+        nFound += hashes->Get(i, hash) && hash == vHash[i];
+    BOOST_CHECK_EQUAL(nFound, nSlots);
+
+    // below the window the slots hold newer blocks, GetBlockHash falls back to chainActive
+    BOOST_CHECK(!hashes->Get(nTip - nSlots, hash));
+    BOOST_CHECK(!hashes->Get(100, hash));
+    BOOST_CHECK(!hashes->Get(0, hash));
+
+    // a tip far ahead of the published one fills the whole window at once
+    std::unique_ptr<CActiveChainHashes> hashesJump(new CActiveChainHashes());
+    hashesJump->SetTip(&vIndex[nTip]);
+    nFound = 0;
+    for (int i = nTip - nSlots + 1; i <= nTip; i++)
+        nFound += hashesJump->Get(i, hash) && hash == vHash[i];
+    BOOST_CHECK_EQUAL(nFound, nSlots);
+    BOOST_CHECK(!hashesJump->Get(nTip - nSlots, hash));
+
+    // disconnecting blocks hides the heights above the new tip
+    const int nForkHeight = nTip - 10;
+    hashes->SetTip(&vIndex[nForkHeight]);
+    BOOST_CHECK_EQUAL(hashes->Height(), nForkHeight);
+    BOOST_CHECK(hashes->Get(nForkHeight, hash) && hash == vHash[nForkHeight]);
+    BOOST_CHECK(!hashes->Get(nForkHeight + 1, hash));
+
+    // a shorter fork replaces them
+    std::vector<uint256> vForkHash(5);
+    std::vector<CBlockIndex> vFork(5);
+    for (int i = 0; i < 5; i++) {
+        vForkHash[i] = GetRandHash();
+        vFork[i].nHeight = nForkHeight + 1 + i;
+        vFork[i].phashBlock = &vForkHash[i];
+        vFork[i].pprev = (i == 0) ? &vIndex[nForkHeight] : &vFork[i - 1];
+    }
+    hashes->SetTip(&vFork[4]);
+    BOOST_CHECK_EQUAL(hashes->Height(), nForkHeight + 5);
+    for (int i = 0; i < 5; i++)
+        BOOST_CHECK(hashes->Get(nForkHeight + 1 + i, hash) && hash == vForkHash[i]);
+    BOOST_CHECK(!hashes->Get(nForkHeight + 6, hash));
+    BOOST_CHECK(hashes->Get(nForkHeight, hash) && hash == vHash[nForkHeight]);
+
+    // and switching back to the longer chain restores it in one step
+    hashes->SetTip(&vIndex[nTip]);
+    for (int i = nForkHeight + 1; i <= nTip; i++)
+        BOOST_CHECK(hashes->Get(i, hash) && hash == vHash[i]);
+}
+
+/** Regtest chain with the address index switched on */
+struct AddressIndexSetup : public TestingSetup {
+    AddressIndexSetup() : TestingSetup(CBaseChainParams::REGTEST) { fAddressIndex = true; }
+    ~AddressIndexSetup() { fAddressIndex = false; }
+
+    void MineBlock(const CScript& scriptPubKey)
+    {
+        const CChainParams& chainparams = Params();
+        std::unique_ptr<CBlockTemplate> pblocktemplate = BlockAssembler(chainparams).CreateNewBlock(scriptPubKey);
+        CBlock& block = pblocktemplate->block;
+        unsigned int extraNonce = 0;
+        IncrementExtraNonce(&block, chainActive.Tip(), extraNonce);
+        while (!CheckProofOfWork(block.GetHash(), block.nBits, chainparams.GetConsensus())) ++block.nNonce;
+        BOOST_CHECK(ProcessNewBlock(chainparams, std::make_shared<const CBlock>(block), true, NULL));
+    }
+};
+
+BOOST_FIXTURE_TEST_CASE(verifydb_addressindex_test, AddressIndexSetup)
+{
+    // few enough blocks for DarkGravityWave to stay at the minimum difficulty
+    const int nBlocks = 10;
+    CKey key;
+    key.MakeNewKey(true);
+    const CKeyID keyID = key.GetPubKey().GetID();
+    const CScript scriptPubKey = GetScriptForDestination(keyID);
+    for (int i = 0; i < nBlocks; i++)
+        MineBlock(scriptPubKey);
+    BOOST_CHECK_EQUAL(chainActive.Height(), nBlocks);
+    FlushStateToDisk();
+
+    CAddressBalanceValue before;
+    BOOST_CHECK(GetAddressBalance(keyID, 1, before));
+    BOOST_CHECK(before.received > 0);
+    BOOST_CHECK_EQUAL(before.utxos, nBlocks);
+
+    // disconnecting blocks on a scratch view, and reconnecting them at level 4, must leave the index alone
+    for (int nCheckLevel = 3; nCheckLevel <= 4; nCheckLevel++) {
+        BOOST_CHECK(CVerifyDB().VerifyDB(Params(), pcoinsdbview, nCheckLevel, nBlocks / 2));
+        FlushStateToDisk();
+
+        CAddressBalanceValue after;
+        BOOST_CHECK(GetAddressBalance(keyID, 1, after));
+        BOOST_CHECK_EQUAL(after.balance, before.balance);
+        BOOST_CHECK_EQUAL(after.received, before.received);
+        BOOST_CHECK_EQUAL(after.utxos, before.utxos);
+        BOOST_CHECK_EQUAL(after.lastHeight, before.lastHeight);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
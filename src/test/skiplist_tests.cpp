@@ -143,4 +143,29 @@ BOOST_AUTO_TEST_CASE(findearliestatleast_test)
         BOOST_CHECK(vBlocksMain[r].GetAncestor(ret->nHeight) == ret);
     }
 }
+BOOST_AUTO_TEST_CASE(blockindex_arena_test)
+{
+    CBlockIndexArena arena;
+    std::vector<CBlockIndex*> vpindex;
+
+    // link a chain over several arena chunks, earlier entries must stay in place
+    for (int i = 0; i < 10000; i++) {
+        CBlockIndex* pindex = arena.Allocate();
+        pindex->nHeight = i;
+        pindex->pprev = i ? vpindex.back() : NULL;
+        pindex->BuildSkip();
+        vpindex.push_back(pindex);
+    }
+    BOOST_CHECK_EQUAL(arena.Size(), 10000U);
+
+    for (int i = 0; i < 10000; i++) {
+        BOOST_CHECK_EQUAL(vpindex[i]->nHeight, i);
+        BOOST_CHECK(vpindex[i]->pprev == (i ? vpindex[i - 1] : NULL));
+    }
+    BOOST_CHECK(vpindex.back()->GetAncestor(1234) == vpindex[1234]);
+
+    arena.Clear();
+    BOOST_CHECK_EQUAL(arena.Size(), 0U);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
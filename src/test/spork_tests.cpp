@@ -0,0 +1,75 @@
+// Copyright (c) 2017-2022 The Advanced Technology Coin
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "base58.h"
+#include "key.h"
+#include "primitives/transaction.h"
+#include "script/standard.h"
+#include "spork.h"
+
+#include "test/test_arc.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(spork_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(evolution_payee_test)
+{
+    const CAmount nEvolution = 5 * COIN;
+    CKey key1, key2;
+    key1.MakeNewKey(true);
+    key2.MakeNewKey(true);
+    const std::string strAddress1 = CBitcoinAddress(key1.GetPubKey().GetID()).ToString();
+    const std::string strAddress2 = CBitcoinAddress(key2.GetPubKey().GetID()).ToString();
+    const CScript script1 = GetScriptForDestination(key1.GetPubKey().GetID());
+    const CScript script2 = GetScriptForDestination(key2.GetPubKey().GetID());
+
+    CEvolutionManager evolution;
+    CMutableTransaction tx;
+    tx.vout.push_back(CTxOut(nEvolution, script1));
+
+    // no list, nothing to check
+    BOOST_CHECK(evolution.IsTransactionValid(tx, 0, nEvolution));
+
+    // the payee rotates with the height
+    evolution.setNewEvolutions("[" + strAddress1 + "," + strAddress2 + "]");
+    CScript scriptPayee;
+    BOOST_CHECK(evolution.getEvolutionScript(2, scriptPayee) && scriptPayee == script1);
+    BOOST_CHECK(evolution.getEvolutionScript(3, scriptPayee) && scriptPayee == script2);
+    BOOST_CHECK(evolution.IsTransactionValid(tx, 2, nEvolution));
+    BOOST_CHECK(!evolution.IsTransactionValid(tx, 3, nEvolution));
+    BOOST_CHECK(!evolution.IsTransactionValid(tx, 2, nEvolution + 1));
+
+    // the same destination in another script form
+    CMutableTransaction txP2PK;
+    txP2PK.vout.push_back(CTxOut(nEvolution, CScript() << ToByteVector(key1.GetPubKey()) << OP_CHECKSIG));
+    BOOST_CHECK(evolution.IsTransactionValid(txP2PK, 2, nEvolution));
+
+    // an output without a destination counts for the one before it
+    CMutableTransaction txCarry;
+    txCarry.vout.push_back(CTxOut(1, script1));
+    txCarry.vout.push_back(CTxOut(nEvolution, CScript() << OP_RETURN));
+    BOOST_CHECK(evolution.IsTransactionValid(txCarry, 2, nEvolution));
+    BOOST_CHECK(!evolution.IsTransactionValid(txCarry, 3, nEvolution));
+
+    // an address that does not parse is never paid, whatever the outputs are
+    evolution.setNewEvolutions("[" + strAddress1 + ",notanaddress]");
+    BOOST_CHECK(evolution.getEvolutionScript(3, scriptPayee) && scriptPayee.empty());
+    BOOST_CHECK(!evolution.IsTransactionValid(tx, 3, nEvolution));
+    BOOST_CHECK(!evolution.IsTransactionValid(txCarry, 3, nEvolution));
+    BOOST_CHECK(evolution.IsTransactionValid(tx, 2, nEvolution));
+
+    // neither is one that only parses with the blank after the comma
+    evolution.setNewEvolutions("[" + strAddress2 + ", " + strAddress1 + "]");
+    BOOST_CHECK(evolution.getEvolution(3) == " " + strAddress1);
+    BOOST_CHECK(!evolution.IsTransactionValid(tx, 3, nEvolution));
+    BOOST_CHECK(!evolution.IsTransactionValid(txP2PK, 3, nEvolution));
+
+    // an empty entry has no script to pay
+    evolution.setNewEvolutions("[" + strAddress1 + ",]");
+    BOOST_CHECK(!evolution.getEvolutionScript(3, scriptPayee));
+    BOOST_CHECK(!evolution.IsTransactionValid(tx, 3, nEvolution));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
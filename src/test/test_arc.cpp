@@ -11,6 +11,7 @@
 #include "consensus/validation.h"
 #include "key.h"
 #include "validation.h"
+#include "messagesigner.h"
 #include "miner.h"
 #include "net_processing.h"
 #include "pubkey.h"
@@ -42,6 +43,7 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
         SetupEnvironment();
         SetupNetworking();
         InitSignatureCache();
+        InitMessageSignatureCache();
         fPrintToDebugLog = false; // don't want to write to debug.log file
         fCheckBlockIndex = true;
         SelectParams(chainName);
@@ -7,6 +7,7 @@
 
 #include "chainparams.h"
 #include "hash.h"
+#include "memusage.h"
 #include "pow.h"
 #include "uint256.h"
 #include "ui_interface.h"
@@ -14,6 +15,10 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
 #include <boost/thread.hpp>
 
 static const char DB_COIN = 'C';
@@ -24,6 +29,9 @@ static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_SPENTINDEX = 'p';
+static const char DB_ADDRESSBALANCE = 'A';
+static const char DB_INDEX_BUILD = 'I';
+static const char DB_INDEX_BEST_BLOCK = 'i';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
@@ -55,7 +63,7 @@ struct CoinEntry {
 
 }
 
-CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", nCacheSize, fMemory, fWipe, true) 
+CCoinsViewDB::CCoinsViewDB(size_t nCacheSize, bool fMemory, bool fWipe) : db(GetDataDir() / "chainstate", CDBOptions::FromArgs("chainstate", nCacheSize), fMemory, fWipe, true)
 {
 }
 
@@ -104,7 +112,10 @@ size_t CCoinsViewDB::EstimateSize() const
     return db.EstimateSize(DB_COIN, (char)(DB_COIN+1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe, size_t nIndexCacheSize) : CDBWrapper(GetDataDir() / "blocks" / "index", CDBOptions::FromArgs("blocks", nCacheSize), fMemory, fWipe) {
+    if (nIndexCacheSize > 0) {
+        pindexdb.reset(new CDBWrapper(GetDataDir() / "indexes", CDBOptions::FromArgs("index", nIndexCacheSize), fMemory, fWipe));
+    }
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -205,11 +216,11 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
 }
 
 bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
-    return Read(std::make_pair(DB_SPENTINDEX, key), value);
+    return IndexDB().Read(std::make_pair(DB_SPENTINDEX, key), value);
 }
 
 bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
+    CDBBatch batch(IndexDB());
     for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
@@ -217,11 +228,11 @@ bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey,
             batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
         }
     }
-    return WriteBatch(batch);
+    return IndexDB().WriteBatch(batch);
 }
 
 bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CDBBatch batch(*this);
+    CDBBatch batch(IndexDB());
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
             batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
@@ -229,13 +240,13 @@ bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddres
             batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
         }
     }
-    return WriteBatch(batch);
+    return IndexDB().WriteBatch(batch);
 }
 
 bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
 
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    std::unique_ptr<CDBIterator> pcursor(IndexDB().NewIterator());
 
     pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
 
@@ -258,25 +269,144 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool CBlockTreeDB::ReadAddressUnspentIndexPage(const CAddressUnspentKey &keyFrom, size_t nLimit,
+                                               std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs,
+                                               CAddressUnspentKey &keyNextRet) {
+
+    std::unique_ptr<CDBIterator> pcursor(IndexDB().NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, keyFrom));
+    keyNextRet.SetNull();
+
+    for (size_t nCount = 0; pcursor->Valid(); nCount++) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressUnspentKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSUNSPENTINDEX || key.second.type != keyFrom.type || key.second.hashBytes != keyFrom.hashBytes)
+            break;
+        if (nCount == nLimit) {
+            keyNextRet = key.second;
+            break;
+        }
+        CAddressUnspentValue nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address unspent value");
+        unspentOutputs.push_back(std::make_pair(key.second, nValue));
+        pcursor->Next();
+    }
+
+    return true;
+}
+
 bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
+    CDBBatch batch(IndexDB());
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
+    UpdateAddressBalances(batch, vect, false);
+    return IndexDB().WriteBatch(batch);
 }
 
 bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
+    CDBBatch batch(IndexDB());
     for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
         batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
+    UpdateAddressBalances(batch, vect, true);
+    return IndexDB().WriteBatch(batch);
+}
+
+void CBlockTreeDB::UpdateAddressBalances(CDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount> >& vect, bool fUndo) {
+    // all entries of a block are applied at once, so every touched address is read and written only once
+    std::map<std::pair<unsigned int, uint160>, std::pair<CAddressBalanceValue, int> > mapBalances;
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        std::pair<unsigned int, uint160> key = std::make_pair(it->first.type, it->first.hashBytes);
+        std::map<std::pair<unsigned int, uint160>, std::pair<CAddressBalanceValue, int> >::iterator mi = mapBalances.find(key);
+        if (mi == mapBalances.end()) {
+            mi = mapBalances.insert(std::make_pair(key, std::make_pair(CAddressBalanceValue(), it->first.blockHeight))).first;
+            ReadAddressBalance(it->first.hashBytes, it->first.type, mi->second.first);
+        }
+        mi->second.first.Apply(it->first, it->second, fUndo);
+        mi->second.second = std::min(mi->second.second, it->first.blockHeight);
+    }
+
+    for (std::map<std::pair<unsigned int, uint160>, std::pair<CAddressBalanceValue, int> >::iterator mi = mapBalances.begin(); mi != mapBalances.end(); ++mi) {
+        CAddressIndexIteratorKey key(mi->first.first, mi->first.second);
+        CAddressBalanceValue& value = mi->second.first;
+        if (fUndo && value.lastHeight >= mi->second.second) {
+            // the last touch is being removed, find the newest entry below the disconnected height
+            value.lastHeight = 0;
+            std::unique_ptr<CDBIterator> pcursor(IndexDB().NewIterator());
+            pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(key.type, key.hashBytes, mi->second.second)));
+            if (pcursor->Valid()) {
+                pcursor->Prev();
+            } else {
+                pcursor->SeekToLast();
+            }
+            std::pair<char,CAddressIndexKey> prevKey;
+            if (pcursor->Valid() && pcursor->GetKey(prevKey) && prevKey.first == DB_ADDRESSINDEX &&
+                    prevKey.second.type == key.type && prevKey.second.hashBytes == key.hashBytes) {
+                value.lastHeight = prevKey.second.blockHeight;
+            }
+        }
+        if (value.IsNull()) {
+            batch.Erase(std::make_pair(DB_ADDRESSBALANCE, key));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSBALANCE, key), value);
+        }
+    }
+}
+
+bool CBlockTreeDB::ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value) {
+    // addresses without any activity have no entry
+    if (!IndexDB().Read(std::make_pair(DB_ADDRESSBALANCE, CAddressIndexIteratorKey(type, addressHash)), value))
+        value.SetNull();
+    return true;
+}
+
+bool CBlockTreeDB::BuildAddressBalances() {
+    LogPrintf("Building address balance index from the address index...\n");
+
+    std::unique_ptr<CDBIterator> pcursor(IndexDB().NewIterator());
+    pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey()));
+
+    // address index keys are sorted by address first, so each address is a contiguous run of entries
+    CDBBatch batch(IndexDB());
+    CAddressIndexIteratorKey current;
+    CAddressBalanceValue value;
+    int64_t nAddresses = 0;
+    while (true) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        bool fEntry = pcursor->Valid() && pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX;
+        if (!fEntry || key.second.type != current.type || key.second.hashBytes != current.hashBytes) {
+            if (!value.IsNull()) {
+                batch.Write(std::make_pair(DB_ADDRESSBALANCE, current), value);
+                nAddresses++;
+            }
+            if (batch.SizeEstimate() > 16 << 20) {
+                if (!IndexDB().WriteBatch(batch))
+                    return error("%s: failed to write address balances", __func__);
+                batch.Clear();
+            }
+            if (!fEntry)
+                break;
+            current = CAddressIndexIteratorKey(key.second.type, key.second.hashBytes);
+            value.SetNull();
+        }
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("%s: failed to get address index value", __func__);
+        value.Apply(key.second, nValue, false);
+        pcursor->Next();
+    }
+
+    LogPrintf("Built address balance index for %d addresses\n", nAddresses);
+    return IndexDB().WriteBatch(batch, true);
 }
 
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                                     int start, int end) {
 
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    std::unique_ptr<CDBIterator> pcursor(IndexDB().NewIterator());
 
     if (start > 0 && end > 0) {
         pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorHeightKey(type, addressHash, start)));
@@ -306,15 +436,45 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool CBlockTreeDB::ReadAddressIndexPage(const CAddressIndexKey &keyFrom, int end, size_t nLimit,
+                                        std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                        CAddressIndexKey &keyNextRet) {
+
+    std::unique_ptr<CDBIterator> pcursor(IndexDB().NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, keyFrom));
+    keyNextRet.SetNull();
+
+    for (size_t nCount = 0; pcursor->Valid(); nCount++) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CAddressIndexKey> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ADDRESSINDEX || key.second.type != keyFrom.type || key.second.hashBytes != keyFrom.hashBytes)
+            break;
+        if (end > 0 && key.second.blockHeight > end)
+            break;
+        if (nCount == nLimit) {
+            keyNextRet = key.second;
+            break;
+        }
+        CAmount nValue;
+        if (!pcursor->GetValue(nValue))
+            return error("failed to get address index value");
+        addressIndex.push_back(std::make_pair(key.second, nValue));
+        pcursor->Next();
+    }
+
+    return true;
+}
+
 bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CDBBatch batch(*this);
+    CDBBatch batch(IndexDB());
     batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
-    return WriteBatch(batch);
+    return IndexDB().WriteBatch(batch);
 }
 
 bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes) {
 
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    std::unique_ptr<CDBIterator> pcursor(IndexDB().NewIterator());
 
     pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
 
@@ -332,8 +492,116 @@ bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned i
     return true;
 }
 
-bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
-    return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
+void CIndexRows::AddUnspent(const CAddressUnspentKey& key, const CAddressUnspentValue& value) {
+    mapAddressUnspentIndex[key] = value;
+}
+
+void CIndexRows::RemoveUnspent(const CAddressUnspentKey& key) {
+    std::map<CAddressUnspentKey, CAddressUnspentValue, CAddressUnspentKeyCompare>::iterator it = mapAddressUnspentIndex.find(key);
+    if (it != mapAddressUnspentIndex.end() && !it->second.IsNull()) {
+        // created in the same range, nothing to erase from the database
+        mapAddressUnspentIndex.erase(it);
+    } else {
+        mapAddressUnspentIndex[key] = CAddressUnspentValue();
+    }
+}
+
+size_t CIndexRows::DynamicMemoryUsage() const {
+    return memusage::DynamicUsage(vAddressIndex) + memusage::DynamicUsage(mapAddressUnspentIndex) +
+           memusage::DynamicUsage(vSpentIndex) + memusage::DynamicUsage(vTimestampIndex);
+}
+
+size_t CIndexRows::Count() const {
+    return vAddressIndex.size() + mapAddressUnspentIndex.size() + vSpentIndex.size() + vTimestampIndex.size();
+}
+
+void CIndexRows::Clear() {
+    vAddressIndex.clear();
+    mapAddressUnspentIndex.clear();
+    vSpentIndex.clear();
+    vTimestampIndex.clear();
+}
+
+namespace {
+
+struct CAddressIndexRowCompare
+{
+    bool operator()(const std::pair<CAddressIndexKey, CAmount>& a, const std::pair<CAddressIndexKey, CAmount>& b) const {
+        return CAddressIndexKeyCompare()(a.first, b.first);
+    }
+};
+
+struct CSpentIndexRowCompare
+{
+    bool operator()(const std::pair<CSpentIndexKey, CSpentIndexValue>& a, const std::pair<CSpentIndexKey, CSpentIndexValue>& b) const {
+        return CSpentIndexKeyCompare()(a.first, b.first);
+    }
+};
+
+} // anon namespace
+
+void CBlockTreeDB::BatchIndexRows(CDBBatch &batch, CIndexRows &rows) {
+    // keys of one address end up next to each other, which keeps the
+    // balance lookups below and the memtable inserts local
+    std::sort(rows.vAddressIndex.begin(), rows.vAddressIndex.end(), CAddressIndexRowCompare());
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=rows.vAddressIndex.begin(); it!=rows.vAddressIndex.end(); it++)
+        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    UpdateAddressBalances(batch, rows.vAddressIndex, false);
+
+    for (std::map<CAddressUnspentKey, CAddressUnspentValue, CAddressUnspentKeyCompare>::const_iterator it=rows.mapAddressUnspentIndex.begin(); it!=rows.mapAddressUnspentIndex.end(); it++) {
+        if (it->second.IsNull()) {
+            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
+        } else {
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+        }
+    }
+
+    std::sort(rows.vSpentIndex.begin(), rows.vSpentIndex.end(), CSpentIndexRowCompare());
+    for (std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >::const_iterator it=rows.vSpentIndex.begin(); it!=rows.vSpentIndex.end(); it++)
+        batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
+
+    for (std::vector<CTimestampIndexKey>::const_iterator it=rows.vTimestampIndex.begin(); it!=rows.vTimestampIndex.end(); it++)
+        batch.Write(std::make_pair(DB_TIMESTAMPINDEX, *it), 0);
+}
+
+bool CBlockTreeDB::WriteIndexRows(CIndexRows &rows, const uint256 &hashBlock, bool fSync) {
+    CDBBatch batch(IndexDB());
+    BatchIndexRows(batch, rows);
+    batch.Write(DB_INDEX_BEST_BLOCK, hashBlock);
+    return IndexDB().WriteBatch(batch, fSync);
+}
+
+bool CBlockTreeDB::ReadIndexBestBlock(uint256 &hashBlock) {
+    return IndexDB().Read(DB_INDEX_BEST_BLOCK, hashBlock);
+}
+
+bool CBlockTreeDB::WriteIndexBestBlock(const uint256 &hashBlock, bool fSync) {
+    return IndexDB().Write(DB_INDEX_BEST_BLOCK, hashBlock, fSync);
+}
+
+bool CBlockTreeDB::WriteIndexRows(CIndexRows &rows, int nIndexes, const uint256 &hashBlock) {
+    CDBBatch batch(IndexDB());
+    BatchIndexRows(batch, rows);
+    batch.Write(DB_INDEX_BUILD, std::make_pair(nIndexes, hashBlock));
+    // the build state has to be on disk before anything refers to it
+    return IndexDB().WriteBatch(batch, true);
+}
+
+bool CBlockTreeDB::ReadIndexBuild(int &nIndexes, uint256 &hashBlock) {
+    std::pair<int, uint256> build;
+    if (!IndexDB().Read(DB_INDEX_BUILD, build))
+        return false;
+    nIndexes = build.first;
+    hashBlock = build.second;
+    return true;
+}
+
+bool CBlockTreeDB::EraseIndexBuild() {
+    return IndexDB().Erase(DB_INDEX_BUILD, true);
+}
+
+bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue, bool fSync) {
+    return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0', fSync);
 }
 
 bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
@@ -344,43 +612,95 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+namespace {
+
+/** Block index rows are decoded in parallel in chunks of this size, then linked in on the calling thread */
+static const size_t BLOCK_INDEX_LOAD_CHUNK = 32768;
+
+enum BlockIndexRowStatus { ROW_OK = 0, ROW_BAD_VALUE, ROW_BAD_POW };
+
+void DecodeBlockIndexRows(const CDBIterator& cursor, const std::vector<char>& vchRows, const std::vector<size_t>& vRowEnds,
+                          size_t nBegin, size_t nEnd, std::vector<CDiskBlockIndex>& vIndex, std::vector<char>& vStatus)
+{
+    const Consensus::Params& consensusParams = Params().GetConsensus();
+    for (size_t i = nBegin; i < nEnd; i++) {
+        const char* pbegin = vchRows.data() + (i == 0 ? 0 : vRowEnds[i - 1]);
+        if (!cursor.DecodeValue(pbegin, vchRows.data() + vRowEnds[i], vIndex[i])) {
+            vStatus[i] = ROW_BAD_VALUE;
+        } else if (!CheckProofOfWork(vIndex[i].GetBlockHash(), vIndex[i].nBits, consensusParams)) {
+            vStatus[i] = ROW_BAD_POW;
+        }
+    }
+}
+
+} // anon namespace
+
 bool CBlockTreeDB::LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex)
 {
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
 
-    // Load mapBlockIndex
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
-
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus()))
-                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+    size_t nThreads = std::max(1, std::min(GetNumCores(), 8));
+    std::vector<char> vchRows;
+    std::vector<size_t> vRowEnds;
+    std::vector<CDiskBlockIndex> vIndex;
+    std::vector<char> vStatus;
+    bool fDone = false;
+
+    // Load mapBlockIndex. The iterator only reads raw rows, decoding and PoW checks of a chunk
+    // are split over several threads and mapBlockIndex is then filled in row order.
+    while (!fDone) {
+        vchRows.clear();
+        vRowEnds.clear();
+        while (vRowEnds.size() < BLOCK_INDEX_LOAD_CHUNK) {
+            boost::this_thread::interruption_point();
+            std::pair<char, uint256> key;
+            if (!pcursor->Valid() || !pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX) {
+                fDone = true;
+                break;
+            }
+            pcursor->GetValueRaw(vchRows);
+            vRowEnds.push_back(vchRows.size());
+            pcursor->Next();
+        }
 
-                pcursor->Next();
-            } else {
+        size_t nRows = vRowEnds.size();
+        vIndex.assign(nRows, CDiskBlockIndex());
+        vStatus.assign(nRows, ROW_OK);
+        size_t nPerThread = (nRows + nThreads - 1) / nThreads;
+        std::vector<std::thread> vThreads;
+        for (size_t nBegin = nPerThread; nBegin < nRows; nBegin += nPerThread) {
+            vThreads.push_back(std::thread(DecodeBlockIndexRows, std::cref(*pcursor), std::cref(vchRows), std::cref(vRowEnds),
+                                           nBegin, std::min(nBegin + nPerThread, nRows), std::ref(vIndex), std::ref(vStatus)));
+        }
+        DecodeBlockIndexRows(*pcursor, vchRows, vRowEnds, 0, std::min(nPerThread, nRows), vIndex, vStatus);
+        for (size_t i = 0; i < vThreads.size(); i++) {
+            vThreads[i].join();
+        }
+
+        for (size_t i = 0; i < nRows; i++) {
+            const CDiskBlockIndex& diskindex = vIndex[i];
+            if (vStatus[i] == ROW_BAD_VALUE)
                 return error("%s: failed to read value", __func__);
-            }
-        } else {
-            break;
+
+            // Construct block index object
+            CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
+            pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+            pindexNew->nHeight        = diskindex.nHeight;
+            pindexNew->nFile          = diskindex.nFile;
+            pindexNew->nDataPos       = diskindex.nDataPos;
+            pindexNew->nUndoPos       = diskindex.nUndoPos;
+            pindexNew->nVersion       = diskindex.nVersion;
+            pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+            pindexNew->nTime          = diskindex.nTime;
+            pindexNew->nBits          = diskindex.nBits;
+            pindexNew->nNonce         = diskindex.nNonce;
+            pindexNew->nStatus        = diskindex.nStatus;
+            pindexNew->nTx            = diskindex.nTx;
+
+            if (vStatus[i] == ROW_BAD_POW)
+                return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
         }
     }
 
@@ -12,6 +12,7 @@
 #include "spentindex.h"
 
 #include <map>
+#include <memory>
 #include <string>
 #include <utility>
 #include <vector>
@@ -40,6 +41,10 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! Max memory allocated to the separate address/spent/timestamp index DB cache (MiB)
+static const int64_t nMaxIndexDBCache = 1024;
+//! -indexdb default
+static const bool DEFAULT_INDEXDB = false;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -108,14 +113,41 @@ private:
     friend class CCoinsViewDB;
 };
 
+/**
+ * Address, spent and timestamp index rows of a range of blocks, as collected
+ * by the background index builder or buffered by ConnectBlock. Unspent outputs
+ * created and spent within the range never reach the database.
+ */
+struct CIndexRows
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vAddressIndex;
+    std::map<CAddressUnspentKey, CAddressUnspentValue, CAddressUnspentKeyCompare> mapAddressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > vSpentIndex;
+    std::vector<CTimestampIndexKey> vTimestampIndex;
+
+    void AddUnspent(const CAddressUnspentKey& key, const CAddressUnspentValue& value);
+    void RemoveUnspent(const CAddressUnspentKey& key);
+    size_t DynamicMemoryUsage() const;
+    size_t Count() const;
+    void Clear();
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
 public:
-    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    /**
+     * With nIndexCacheSize > 0 the address, spent and timestamp indexes are kept
+     * in a database of their own (indexes/) that gets this much cache.
+     */
+    CBlockTreeDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, size_t nIndexCacheSize = 0);
 private:
     CBlockTreeDB(const CBlockTreeDB&);
     void operator=(const CBlockTreeDB&);
+
+    //! Separate database for the address, spent and timestamp indexes, NULL if they live in this one
+    std::unique_ptr<CDBWrapper> pindexdb;
+    CDBWrapper& IndexDB() { return pindexdb ? *pindexdb : *this; }
 public:
     bool WriteBatchSync(const std::vector<std::pair<int, const CBlockFileInfo*> >& fileInfo, int nLastFile, const std::vector<const CBlockIndex*>& blockinfo);
     bool ReadBlockFileInfo(int nFile, CBlockFileInfo &fileinfo);
@@ -129,16 +161,40 @@ public:
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    /** Read at most nLimit unspent outputs of keyFrom's address, starting at keyFrom. keyNextRet is null when there are no more. */
+    bool ReadAddressUnspentIndexPage(const CAddressUnspentKey &keyFrom, size_t nLimit,
+                                     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect,
+                                     CAddressUnspentKey &keyNextRet);
     bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                           int start = 0, int end = 0);
+    /** Read at most nLimit entries of keyFrom's address up to height end (if > 0), starting at keyFrom. keyNextRet is null when there are no more. */
+    bool ReadAddressIndexPage(const CAddressIndexKey &keyFrom, int end, size_t nLimit,
+                              std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                              CAddressIndexKey &keyNextRet);
+    bool ReadAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &value);
+    bool BuildAddressBalances();
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
-    bool WriteFlag(const std::string &name, bool fValue);
+    /**
+     * Write the rows in key order in a single synced batch, together with the state
+     * of the index build (the INDEX_BUILD_* mask and the last block the rows cover).
+     */
+    bool WriteIndexRows(CIndexRows &rows, int nIndexes, const uint256 &hashBlock);
+    /** Write the rows of connected blocks in key order in a single batch, hashBlock being the last of them */
+    bool WriteIndexRows(CIndexRows &rows, const uint256 &hashBlock, bool fSync = false);
+    bool ReadIndexBestBlock(uint256 &hashBlock);
+    bool WriteIndexBestBlock(const uint256 &hashBlock, bool fSync = false);
+    bool ReadIndexBuild(int &nIndexes, uint256 &hashBlock);
+    bool EraseIndexBuild();
+    bool WriteFlag(const std::string &name, bool fValue, bool fSync = false);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts(boost::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+private:
+    void BatchIndexRows(CDBBatch &batch, CIndexRows &rows);
+    void UpdateAddressBalances(CDBBatch& batch, const std::vector<std::pair<CAddressIndexKey, CAmount> >& vect, bool fUndo);
 };
 
 #endif // BITCOIN_TXDB_H
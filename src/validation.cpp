@@ -46,6 +46,7 @@
 
 #include <atomic>
 #include <sstream>
+#include <thread>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -66,6 +67,8 @@
 CCriticalSection cs_main;
 
 BlockMap mapBlockIndex;
+/** Storage of the CBlockIndex entries in mapBlockIndex */
+static CBlockIndexArena blockIndexArena;
 CChain chainActive;
 CBlockIndex *pindexBestHeader = NULL;
 CWaitableCriticalSection csBestBlock;
@@ -85,6 +88,7 @@ unsigned int nBytesPerSigOp = DEFAULT_BYTES_PER_SIGOP;
 bool fCheckBlockIndex = false;
 bool fCheckpointsEnabled = DEFAULT_CHECKPOINTS_ENABLED;
 size_t nCoinCacheUsage = 5000 * 300;
+size_t nIndexBufferUsage = DEFAULT_INDEX_BUFFER << 20;
 uint64_t nPruneTarget = 0;
 bool fAlerts = DEFAULT_ALERTS;
 int64_t nMaxTipAge = DEFAULT_MAX_TIP_AGE;
@@ -1126,6 +1130,29 @@ bool GetAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
+bool GetAddressIndexPage(const CAddressIndexKey &keyFrom, int end, size_t nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, CAddressIndexKey &keyNextRet)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressIndexPage(keyFrom, end, nLimit, addressIndex, keyNextRet))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &balance)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressBalance(addressHash, type, balance))
+        return error("unable to get balance for address");
+
+    return true;
+}
+
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
 {
@@ -1138,6 +1165,18 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     return true;
 }
 
+bool GetAddressUnspentPage(const CAddressUnspentKey &keyFrom, size_t nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs, CAddressUnspentKey &keyNextRet)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pblocktree->ReadAddressUnspentIndexPage(keyFrom, nLimit, unspentOutputs, keyNextRet))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
 /** Return transaction in txOut, and if it was found inside a block, its hash is placed in hashBlock */
 bool GetTransaction(const uint256 &hash, CTransactionRef &txOut, const Consensus::Params& consensusParams, uint256 &hashBlock, bool fAllowSlow)
 {
@@ -1644,6 +1683,8 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
+} // anon namespace
+
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
     // Open history file to read
@@ -1670,6 +1711,8 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
     return true;
 }
 
+namespace {
+
 /** Abort with a message */
 bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
 {
@@ -1690,6 +1733,133 @@ bool AbortNode(CValidationState& state, const std::string& strMessage, const std
 
 } // anon namespace
 
+int GetIndexAddress(const CScript& script, uint160& hashBytes)
+{
+    if (script.IsPayToScriptHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin()+2, script.begin()+22));
+        return 2;
+    } else if (script.IsPayToPublicKeyHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin()+3, script.begin()+23));
+        return 1;
+    } else if (script.IsPayToPublicKey()) {
+        hashBytes = Hash160(script.begin()+1, script.end()-1);
+        return 1;
+    }
+    hashBytes.SetNull();
+    return 0;
+}
+
+bool AddBlockIndexRows(CIndexRows& rows, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex,
+                       bool fAddress, bool fSpent, bool fTimestamp)
+{
+    const bool fInputs = fAddress || fSpent;
+    if (fInputs && blockundo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent at height %d", __func__, pindex->nHeight);
+
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction &tx = *(block.vtx[i]);
+        const uint256 txhash = tx.GetHash();
+
+        if (fInputs && !tx.IsCoinBase()) {
+            const CTxUndo &txundo = blockundo.vtxundo[i - 1];
+            if (txundo.vprevout.size() != tx.vin.size())
+                return error("%s: transaction and undo data inconsistent at height %d", __func__, pindex->nHeight);
+
+            for (size_t j = 0; j < tx.vin.size(); j++) {
+                const CTxIn &input = tx.vin[j];
+                const CTxOut &prevout = txundo.vprevout[j].out;
+                uint160 hashBytes;
+                int addressType = GetIndexAddress(prevout.scriptPubKey, hashBytes);
+
+                if (fAddress && addressType > 0) {
+                    // record spending activity
+                    rows.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
+
+                    // remove address from unspent index
+                    rows.RemoveUnspent(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n));
+                }
+
+                if (fSpent) {
+                    // add the spent index to determine the txid and input that spent an output
+                    // and to find the amount and address from an input
+                    rows.vSpentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
+                }
+            }
+        }
+
+        if (fAddress) {
+            for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                const CTxOut &out = tx.vout[k];
+                uint160 hashBytes;
+                int addressType = GetIndexAddress(out.scriptPubKey, hashBytes);
+                if (addressType == 0)
+                    continue;
+
+                // record receiving activity
+                rows.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, k, false), out.nValue));
+
+                // record unspent output
+                rows.AddUnspent(CAddressUnspentKey(addressType, hashBytes, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight));
+            }
+        }
+    }
+
+    if (fTimestamp)
+        rows.vTimestampIndex.push_back(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash()));
+
+    return true;
+}
+
+/**
+ * Address, spent and timestamp index rows of connected blocks that are not in
+ * the database yet. During initial block download they are written together
+ * by FlushStateToDisk, before the chainstate. Protected by cs_main.
+ */
+static CIndexRows indexRowsPending;
+//! Last block with rows in indexRowsPending
+static uint256 hashIndexPending;
+//! Last block with rows in the database, replaying it after a crash must not add them again
+static uint256 hashIndexBest;
+
+/**
+ * Write the pending rows. With fSync they, and any rows erased by disconnected
+ * blocks before, are on disk before the chainstate that is flushed next.
+ */
+static bool FlushIndexRows(CValidationState& state, bool fSync = false)
+{
+    AssertLockHeld(cs_main);
+    if (hashIndexPending.IsNull()) {
+        if (fSync && !hashIndexBest.IsNull() && !pblocktree->WriteIndexBestBlock(hashIndexBest, true))
+            return AbortNode(state, "Failed to write index");
+        return true;
+    }
+    if (!pblocktree->WriteIndexRows(indexRowsPending, hashIndexPending, fSync))
+        return AbortNode(state, "Failed to write index");
+    indexRowsPending.Clear();
+    hashIndexBest = hashIndexPending;
+    hashIndexPending.SetNull();
+    return true;
+}
+
+static bool IsIndexAncestor(const uint256& hashIndex, const CBlockIndex* pindex)
+{
+    if (hashIndex.IsNull())
+        return false;
+    // looked up every time, the block may only be known again after its header was downloaded
+    BlockMap::iterator mi = mapBlockIndex.find(hashIndex);
+    return mi != mapBlockIndex.end() && mi->second->GetAncestor(pindex->nHeight) == pindex;
+}
+
+/**
+ * Whether the index rows of pindex are written or pending already. Blocks
+ * connected again after a crash, or by VerifyDB, must not add them twice.
+ */
+static bool IsIndexWritten(const CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    return IsIndexAncestor(hashIndexPending, pindex) || IsIndexAncestor(hashIndexBest, pindex);
+}
+
 enum DisconnectResult
 {
     DISCONNECT_OK,      // All good.
@@ -1728,8 +1898,10 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 }
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
+ *  With fUpdateIndexes its rows are also removed from the address, spent and timestamp
+ *  indexes, which is only right when the block leaves the active chain.
  *  When UNCLEAN or FAILED is returned, view is left in an indeterminate state. */
-static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& state, const CBlockIndex* pindex, CCoinsViewCache& view)
+static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& state, const CBlockIndex* pindex, CCoinsViewCache& view, bool fUpdateIndexes = false)
 {
     assert(pindex->GetBlockHash() == view.GetBestBlock());
 
@@ -1765,33 +1937,16 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
 
             for (unsigned int k = tx.vout.size(); k-- > 0;) {
                 const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, k, false), out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, k), CAddressUnspentValue()));
-                } else {
+                uint160 hashBytes;
+                int addressType = GetIndexAddress(out.scriptPubKey, hashBytes);
+                if (addressType == 0)
                     continue;
-                }
 
+                // undo receiving activity
+                addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, hash, k, false), out.nValue));
+
+                // undo unspent index
+                addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, hash, k), CAddressUnspentValue()));
             }
 
         }
@@ -1833,32 +1988,16 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
                 if (fAddressIndex) {
                     const Coin &coin = view.AccessCoin(tx.vin[j].prevout);
                     const CTxOut &prevout = coin.out;
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undoHeight)));
-
-
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
+                    uint160 hashBytes;
+                    int addressType = GetIndexAddress(prevout.scriptPubKey, hashBytes);
+                    if (addressType == 0)
+                        continue;
 
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undoHeight)));
+                    // undo spending activity
+                    addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
 
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, j, false), prevout.nValue));
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, j), CAddressUnspentValue()));
-                    } else {
-                        continue;
-                    }
+                    // restore unspent index
+                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undoHeight)));
                 }
 
             }
@@ -1870,15 +2009,32 @@ static DisconnectResult DisconnectBlock(const CBlock& block, CValidationState& s
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    if (fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            AbortNode(state, "Failed to delete address index");
+    if (fUpdateIndexes && (fAddressIndex || fSpentIndex || fTimestampIndex)) {
+        // the rows of this block may not be written yet
+        if (!FlushIndexRows(state))
             return DISCONNECT_FAILED;
+        if (fAddressIndex) {
+            if (!pblocktree->EraseAddressIndex(addressIndex)) {
+                AbortNode(state, "Failed to delete address index");
+                return DISCONNECT_FAILED;
+            }
+            if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
+                AbortNode(state, "Failed to write address unspent index");
+                return DISCONNECT_FAILED;
+            }
         }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            AbortNode(state, "Failed to write address unspent index");
+        if (fSpentIndex && !pblocktree->UpdateSpentIndex(spentIndex)) {
+            AbortNode(state, "Failed to delete spent index");
             return DISCONNECT_FAILED;
         }
+        // reconnecting the block has to add its rows again
+        if (hashIndexBest == pindex->GetBlockHash()) {
+            hashIndexBest = pindex->pprev->GetBlockHash();
+            if (!pblocktree->WriteIndexBestBlock(hashIndexBest)) {
+                AbortNode(state, "Failed to write index best block");
+                return DISCONNECT_FAILED;
+            }
+        }
     }
 
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
@@ -1916,6 +2072,17 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+static CCheckQueue<CHeaderCheck> headercheckqueue(16);
+
+void ThreadHeaderCheck() {
+    RenameThread("arc-headerch");
+    headercheckqueue.Thread();
+}
+
+bool CHeaderCheck::operator()() {
+    return CheckProofOfWork(pheader->GetHash(), pheader->nBits, *pconsensusParams);
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -1952,8 +2119,25 @@ int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Para
     return nVersion;
 }
 
+static CActiveChainHashes activeChainHashes;
+
+void SetActiveChainTip(CBlockIndex* pindex)
+{
+    chainActive.SetTip(pindex);
+    activeChainHashes.SetTip(pindex);
+}
+
+int GetActiveChainHeight()
+{
+    return activeChainHashes.Height();
+}
+
 bool GetBlockHash(uint256& hashRet, int nBlockHeight)
 {
+    if(nBlockHeight == -1) nBlockHeight = activeChainHashes.Height();
+    if(activeChainHashes.Get(nBlockHeight, hashRet)) return true;
+
+    // older than the published window
     LOCK(cs_main);
     if(chainActive.Tip() == NULL) return false;
     if(nBlockHeight < -1 || nBlockHeight > chainActive.Height()) return false;
@@ -2130,16 +2314,12 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     std::vector<std::pair<uint256, CDiskTxPos> > vPos;
     vPos.reserve(block.vtx.size());
     blockundo.vtxundo.reserve(block.vtx.size() - 1);
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
     bool fDIP0001Active_context = pindex->nHeight >= Params().GetConsensus().DIP0001Height;
 
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
-        const uint256 txhash = tx.GetHash();
 
         nInputs += tx.vin.size();
         nSigOps += GetLegacySigOpCount(tx);
@@ -2166,46 +2346,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                                  REJECT_INVALID, "bad-txns-nonfinal");
             }
 
-            if (fAddressIndex || fSpentIndex)
-            {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-                    const CTxIn input = tx.vin[j];
-                    const Coin& coin = view.AccessCoin(tx.vin[j].prevout);
-                    const CTxOut &prevout = coin.out;
-                    uint160 hashBytes;
-                    int addressType;
-
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        hashBytes = uint160(std::vector<unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
-                        addressType = 2;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        hashBytes = uint160(std::vector<unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
-                        addressType = 1;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        hashBytes = Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1);
-                        addressType = 1;
-                    } else {
-                        hashBytes.SetNull();
-                        addressType = 0;
-                    }
-
-                    if (fAddressIndex && addressType > 0) {
-                        // record spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
-
-                        // remove address from unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                    }
-
-                    if (fSpentIndex) {
-                        // add the spent index to determine the txid and input that spent an output
-                        // and to find the amount and address from an input
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
-                    }
-                }
-
-            }
-
             if (fStrictPayToScriptHash)
             {
                 // Add in sigops done by pay-to-script-hash inputs;
@@ -2227,39 +2367,6 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             control.Add(vChecks);
         }
 
-        if (fAddressIndex) {
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, txhash, k, false), out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-                } else {
-                    continue;
-                }
-
-            }
-        }
-
         CTxUndo undoDummy;
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
@@ -2335,24 +2442,13 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
 
-    if (fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
+    // Index rows are written by FlushStateToDisk
+    if ((fAddressIndex || fSpentIndex || fTimestampIndex) && !IsIndexWritten(pindex)) {
+        if (!AddBlockIndexRows(indexRowsPending, block, blockundo, pindex, fAddressIndex, fSpentIndex, fTimestampIndex))
+            return AbortNode(state, "Failed to collect index rows");
+        hashIndexPending = pindex->GetBlockHash();
     }
 
-    if (fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
-
-    if (fTimestampIndex)
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(pindex->nTime, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
-
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
@@ -2456,6 +2552,13 @@ bool static FlushStateToDisk(CValidationState &state, FlushStateMode mode, int n
             UnlinkPrunedFiles(setFilesToPrune);
         nLastWrite = nNow;
     }
+    // Index rows are only kept back during initial block download, and up to -indexbuffer.
+    // They go first, blocks already indexed are not indexed again when they are replayed.
+    // Before a chainstate flush they are synced, the index may live in a database of its own.
+    if (fDoFullFlush || !IsInitialBlockDownload() || indexRowsPending.DynamicMemoryUsage() > nIndexBufferUsage) {
+        if (!FlushIndexRows(state, fDoFullFlush))
+            return false;
+    }
     // Flush best chain related state. This can only be done if the blocks / block index write was also done.
     if (fDoFullFlush) {
         // Typical Coin structures on disk are around 48 bytes in size.
@@ -2494,7 +2597,7 @@ void PruneAndFlush() {
 
 /** Update chainActive and related internal data structures. */
 void static UpdateTip(CBlockIndex *pindexNew, const CChainParams& chainParams) {
-    chainActive.SetTip(pindexNew);
+    SetActiveChainTip(pindexNew);
 
     // New best block
     mempool.AddTransactionsUpdated(1);
@@ -2567,7 +2670,7 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
     int64_t nStart = GetTimeMicros();
     {
         CCoinsViewCache view(pcoinsTip);
-        if (DisconnectBlock(block, state, pindexDelete, view) != DISCONNECT_OK)
+        if (DisconnectBlock(block, state, pindexDelete, view, true) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         bool flushed = view.Flush();
         assert(flushed);
@@ -2604,7 +2707,64 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
     return true;
 }
 
+/** Blocks spending fewer uncached coins than this are not worth starting prefetch threads for */
+static const size_t PREFETCH_MIN_INPUTS = 64;
+static const int PREFETCH_MAX_THREADS = 8;
+
+/**
+ * Read the coins a block spends from the coins database on several threads and put them
+ * into pcoinsTip, before ConnectBlock looks them up one at a time. On a cold cache every
+ * lookup is a disk read, so this turns a long series of serial reads into parallel ones.
+ */
+static void PrefetchBlockInputs(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    if (!pcoinsdbview || !pcoinsTip)
+        return;
+
+    std::set<uint256> setBlockTxids;
+    for (const auto& tx : block.vtx)
+        setBlockTxids.insert(tx->GetHash());
+
+    std::vector<COutPoint> vOutpoints;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase())
+            continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (!setBlockTxids.count(txin.prevout.hash) && !pcoinsTip->HaveCoinInCache(txin.prevout))
+                vOutpoints.push_back(txin.prevout);
+        }
+    }
+    if (vOutpoints.size() < PREFETCH_MIN_INPUTS)
+        return;
+
+    int nThreads = std::min(std::max(nScriptCheckThreads, 2), PREFETCH_MAX_THREADS);
+    std::vector<Coin> vCoins(vOutpoints.size());
+    std::vector<char> vFound(vOutpoints.size(), 0);
+    auto fetch = [&](int nThread) {
+        for (size_t i = nThread; i < vOutpoints.size(); i += nThreads) {
+            try {
+                vFound[i] = pcoinsdbview->GetCoin(vOutpoints[i], vCoins[i]);
+            } catch (const std::exception&) {
+                // leave it to the regular lookup, which reports database errors
+            }
+        }
+    };
+    std::vector<std::thread> vThreads;
+    for (int i = 1; i < nThreads; i++)
+        vThreads.push_back(std::thread(fetch, i));
+    fetch(0);
+    for (auto& thread : vThreads)
+        thread.join();
+
+    for (size_t i = 0; i < vOutpoints.size(); i++) {
+        if (vFound[i])
+            pcoinsTip->AddFetchedCoin(vOutpoints[i], std::move(vCoins[i]));
+    }
+}
+
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
@@ -2644,6 +2804,10 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDisk += nTime2 - nTime1;
     int64_t nTime3;
     LogPrint("bench", "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * 0.001, nTimeReadFromDisk * 0.000001);
+    PrefetchBlockInputs(blockConnecting);
+    int64_t nTimePrefetched = GetTimeMicros(); nTimePrefetch += nTimePrefetched - nTime2;
+    LogPrint("bench", "  - Prefetch inputs: %.2fms [%.2fs]\n", (nTimePrefetched - nTime2) * 0.001, nTimePrefetch * 0.000001);
+    nTime2 = nTimePrefetched;
     {
         CCoinsViewCache view(pcoinsTip);
         bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, chainparams);
@@ -3097,8 +3261,7 @@ CBlockIndex* AddToBlockIndex(const CBlockHeader& block)
         return it->second;
 
     // Construct new block index object
-    CBlockIndex* pindexNew = new CBlockIndex(block);
-    assert(pindexNew);
+    CBlockIndex* pindexNew = blockIndexArena.Allocate(block);
     // We assign the sequence id to blocks only when the full data is available,
     // to avoid miners withholding blocks but broadcasting headers, to get a
     // competitive advantage.
@@ -3526,6 +3689,20 @@ static bool AcceptBlockHeader(const CBlockHeader& block, CValidationState& state
 // Exposed wrapper for AcceptBlockHeader
 bool ProcessNewBlockHeaders(const std::vector<CBlockHeader>& headers, CValidationState& state, const CChainParams& chainparams, const CBlockIndex** ppindex)
 {
+    // Hash and PoW-check the whole batch on the worker pool before taking
+    // cs_main. AcceptBlockHeader below then finds the hashes cached and only
+    // linking into mapBlockIndex stays serial. A failing check just stops the
+    // pool early; the serial pass reports it with the proper state.
+    if (nScriptCheckThreads && headers.size() > 1) {
+        CCheckQueueControl<CHeaderCheck> control(&headercheckqueue);
+        std::vector<CHeaderCheck> vChecks;
+        vChecks.reserve(headers.size());
+        for (const CBlockHeader& header : headers)
+            vChecks.push_back(CHeaderCheck(header, chainparams.GetConsensus()));
+        control.Add(vChecks);
+        control.Wait();
+    }
+
     {
         LOCK(cs_main);
         for (const CBlockHeader& header : headers) {
@@ -3881,9 +4058,7 @@ CBlockIndex * InsertBlockIndex(uint256 hash)
         return (*mi).second;
 
     // Create new
-    CBlockIndex* pindexNew = new CBlockIndex();
-    if (!pindexNew)
-        throw std::runtime_error(std::string(__func__) + ": new CBlockIndex failed");
+    CBlockIndex* pindexNew = blockIndexArena.Allocate();
     mi = mapBlockIndex.insert(std::make_pair(hash, pindexNew)).first;
     pindexNew->phashBlock = &((*mi).first);
 
@@ -3988,6 +4163,17 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadFlag("addressindex", fAddressIndex);
     LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
+    // Address indexes created before balances were tracked need them built once
+    if (fAddressIndex) {
+        bool fAddressBalance = false;
+        pblocktree->ReadFlag("addressbalance", fAddressBalance);
+        if (!fAddressBalance) {
+            if (!pblocktree->BuildAddressBalances())
+                return error("%s: failed to build address balances", __func__);
+            pblocktree->WriteFlag("addressbalance", true);
+        }
+    }
+
     // Check whether we have a timestamp index
     pblocktree->ReadFlag("timestampindex", fTimestampIndex);
     LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
@@ -3996,11 +4182,15 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
+    // Blocks up to this one are indexed already if they are connected again
+    if (!pblocktree->ReadIndexBestBlock(hashIndexBest))
+        hashIndexBest.SetNull();
+
     // Load pointer to end of best chain
     BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
     if (it == mapBlockIndex.end())
         return true;
-    chainActive.SetTip(it->second);
+    SetActiveChainTip(it->second);
 
     PruneBlockIndexCandidates();
 
@@ -4124,7 +4314,7 @@ void UnloadBlockIndex()
 {
     LOCK(cs_main);
     setBlockIndexCandidates.clear();
-    chainActive.SetTip(NULL);
+    SetActiveChainTip(NULL);
     pindexBestInvalid = NULL;
     pindexBestHeader = NULL;
     mempool.clear();
@@ -4134,15 +4324,16 @@ void UnloadBlockIndex()
     nBlockSequenceId = 1;
     setDirtyBlockIndex.clear();
     setDirtyFileInfo.clear();
+    indexRowsPending.Clear();
+    hashIndexPending.SetNull();
+    hashIndexBest.SetNull();
     versionbitscache.Clear();
     for (int b = 0; b < VERSIONBITS_NUM_BITS; b++) {
         warningcache[b].clear();
     }
 
-    BOOST_FOREACH(BlockMap::value_type& entry, mapBlockIndex) {
-        delete entry.second;
-    }
     mapBlockIndex.clear();
+    blockIndexArena.Clear();
     fHavePruned = false;
 }
 
@@ -4184,6 +4375,7 @@ bool InitBlockIndex(const CChainParams& chainparams)
     // Use the provided setting for -addressindex in the new database
     fAddressIndex = GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
     pblocktree->WriteFlag("addressindex", fAddressIndex);
+    pblocktree->WriteFlag("addressbalance", fAddressIndex);
 
     // Use the provided setting for -timestampindex in the new database
     fTimestampIndex = GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
@@ -4192,6 +4384,9 @@ bool InitBlockIndex(const CChainParams& chainparams)
     fSpentIndex = GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
     pblocktree->WriteFlag("spentindex", fSpentIndex);
 
+    // Remember where the indexes above are kept
+    pblocktree->WriteFlag("indexdb", GetBoolArg("-indexdb", DEFAULT_INDEXDB));
+
     LogPrintf("Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -4681,9 +4876,7 @@ public:
     CMainCleanup() {}
     ~CMainCleanup() {
         // block headers
-        BlockMap::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
         mapBlockIndex.clear();
+        blockIndexArena.Clear();
     }
 } instance_of_cmaincleanup;
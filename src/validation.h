@@ -35,6 +35,7 @@
 #include <boost/filesystem/path.hpp>
 
 class CBlockIndex;
+class CBlockUndo;
 class CBlockTreeDB;
 class CBloomFilter;
 class CChainParams;
@@ -46,6 +47,7 @@ class CTxMemPool;
 class CValidationInterface;
 class CValidationState;
 struct ChainTxData;
+struct CIndexRows;
 
 struct LockPoints;
 
@@ -136,6 +138,8 @@ static const bool DEFAULT_TXINDEX = true;
 static const bool DEFAULT_ADDRESSINDEX = false;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const bool DEFAULT_SPENTINDEX = false;
+/** Default for -indexbuffer, memory for index rows kept back during initial block download (MiB) */
+static const int64_t DEFAULT_INDEX_BUFFER = 64;
 static const unsigned int DEFAULT_BANSCORE_THRESHOLD = 100;
 
 /** Default for -mempoolreplacement */
@@ -168,12 +172,16 @@ extern std::atomic_bool fImporting;
 extern bool fReindex;
 extern int nScriptCheckThreads;
 extern bool fTxIndex;
+extern bool fAddressIndex;
+extern bool fTimestampIndex;
+extern bool fSpentIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern unsigned int nBytesPerSigOp;
 extern bool fCheckBlockIndex;
 extern bool fCheckpointsEnabled;
 extern size_t nCoinCacheUsage;
+extern size_t nIndexBufferUsage;
 /** A fee rate smaller than this is considered zero fee (for relaying, mining and transaction creation) */
 extern CFeeRate minRelayTxFee;
 /** Absolute maximum transaction fee (in duffs) used by wallet and mempool (rejects high fee in sendrawtransaction) */
@@ -273,6 +281,8 @@ bool LoadBlockIndex(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the header proof-of-work checking thread */
+void ThreadHeaderCheck();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 /** Format a string that describes several potential problems detected by the core.
@@ -472,18 +482,54 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/**
+ * Closure representing one header proof-of-work check.
+ * Computing the hash also fills the header's hash cache, so running these
+ * on the check queue moves the X11 work of a headers batch off cs_main.
+ * Note that this stores references to the header and consensus params.
+ */
+class CHeaderCheck
+{
+private:
+    const CBlockHeader *pheader;
+    const Consensus::Params *pconsensusParams;
+
+public:
+    CHeaderCheck(): pheader(0), pconsensusParams(0) {}
+    CHeaderCheck(const CBlockHeader& headerIn, const Consensus::Params& consensusParamsIn) :
+        pheader(&headerIn), pconsensusParams(&consensusParamsIn) { }
+
+    bool operator()();
+
+    void swap(CHeaderCheck &check) {
+        std::swap(pheader, check.pheader);
+        std::swap(pconsensusParams, check.pconsensusParams);
+    }
+};
+
 bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
 bool GetAddressIndex(uint160 addressHash, int type,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                      int start = 0, int end = 0);
+bool GetAddressBalance(uint160 addressHash, int type, CAddressBalanceValue &balance);
+bool GetAddressIndexPage(const CAddressIndexKey &keyFrom, int end, size_t nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, CAddressIndexKey &keyNextRet);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+bool GetAddressUnspentPage(const CAddressUnspentKey &keyFrom, size_t nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs, CAddressUnspentKey &keyNextRet);
+/** Address type (2 for P2SH, 1 for P2PKH and P2PK) and hash of a script as stored in the address and spent indexes, 0 if it has none */
+int GetIndexAddress(const CScript& script, uint160& hashBytes);
+/** Add the address, spent and timestamp index rows of a connected block, the spent outputs come from its undo data */
+bool AddBlockIndexRows(CIndexRows& rows, const CBlock& block, const CBlockUndo& blockundo, const CBlockIndex* pindex,
+                       bool fAddress, bool fSpent, bool fTimestamp);
 
 /** Functions for disk access for blocks */
 bool WriteBlockToDisk(const CBlock& block, CDiskBlockPos& pos, const CMessageHeader::MessageStartChars& messageStart);
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -550,9 +596,16 @@ extern VersionBitsCache versionbitscache;
  */
 int32_t ComputeBlockVersion(const CBlockIndex* pindexPrev, const Consensus::Params& params, bool fAssumeGoldminenodeIsUpgraded = false);
 
+/** Make pindex the tip of chainActive and publish its hashes to GetBlockHash */
+void SetActiveChainTip(CBlockIndex* pindex);
+
+/** Height of the active chain tip without taking cs_main, -1 before the chain is loaded */
+int GetActiveChainHeight();
+
 /**
  * Return true if hash can be found in chainActive at nBlockHeight height.
  * Fills hashRet with found hash, if no nBlockHeight is specified - chainActive.Height() is used.
+ * Recent heights are answered without taking cs_main.
  */
 bool GetBlockHash(uint256& hashRet, int nBlockHeight = -1);
 